@@ -0,0 +1,230 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Alfredo Mazzinghi
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+#include <QCoreApplication>
+#include <array>
+#include <benchmark/benchmark.h>
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+#include "flat_layout_scraper.hh"
+#include "storage.hh"
+
+using namespace cheri;
+namespace dwarf = llvm::dwarf;
+
+namespace {
+
+/*
+ * Sub-object lengths used to exercise the capability compression.
+ * These cover both exactly representable and imprecise lengths.
+ */
+constexpr std::array<uint64_t, 8> kLengths = {
+    0x10, 0x1001, 0x4002, 0x8002, 0xfff1, 0x10000, 0x123457, 0x7ffffff3};
+
+std::unique_ptr<StorageManager> storage;
+
+/*
+ * Expose the flat layout scraper internals to the benchmarks.
+ */
+class BenchFlatLayoutScraper : public FlatLayoutScraper {
+public:
+  using FlatLayoutScraper::FlatLayoutScraper;
+  using FlatLayoutScraper::checkNestedPadding;
+  using FlatLayoutScraper::checkPadding;
+  using FlatLayoutScraper::initSchema;
+  using FlatLayoutScraper::recordLayout;
+  using FlatLayoutScraper::visitCommon;
+
+  void clearLayouts() { layouts_.clear(); }
+
+  /*
+   * Flatten the given aggregate DIEs and take ownership of the layouts.
+   */
+  std::vector<std::unique_ptr<FlattenedLayout>>
+  flatten(const std::vector<llvm::DWARFDie> &dies) {
+    std::vector<std::unique_ptr<FlattenedLayout>> layouts;
+    for (auto &die : dies)
+      visitCommon(die);
+    for (auto &[id, layout] : layouts_) {
+      checkPadding(*layout);
+      layouts.emplace_back(std::move(layout));
+    }
+    layouts_.clear();
+    return layouts;
+  }
+};
+
+std::unique_ptr<BenchFlatLayoutScraper> makeScraper(const char *path) {
+  auto source = std::make_unique<DwarfSource>(std::filesystem::path(path));
+  return std::make_unique<BenchFlatLayoutScraper>(*storage, std::move(source));
+}
+
+/*
+ * Collect the top-level named aggregate definitions in all compilation units.
+ */
+std::vector<llvm::DWARFDie> collectAggregates(const DwarfSource &dwsrc) {
+  std::vector<llvm::DWARFDie> dies;
+  for (auto &unit : dwsrc.getContext().info_section_units()) {
+    if (!llvm::isCompileUnit(unit))
+      continue;
+    for (auto child : unit->getUnitDIE(false).children()) {
+      auto tag = child.getTag();
+      if (tag != dwarf::DW_TAG_structure_type &&
+          tag != dwarf::DW_TAG_union_type && tag != dwarf::DW_TAG_class_type)
+        continue;
+      if (!child.find(dwarf::DW_AT_name) ||
+          child.find(dwarf::DW_AT_declaration))
+        continue;
+      dies.push_back(child);
+    }
+  }
+  return dies;
+}
+
+void BM_RepresentablePadding(benchmark::State &state, CapFormat format) {
+  for (auto _ : state) {
+    for (auto length : kLengths)
+      benchmark::DoNotOptimize(findRepresentablePadding(format, length));
+  }
+  state.SetItemsProcessed(state.iterations() * kLengths.size());
+}
+BENCHMARK_CAPTURE(BM_RepresentablePadding, morello, CapFormat::Morello);
+BENCHMARK_CAPTURE(BM_RepresentablePadding, riscv128, CapFormat::RISCV128);
+BENCHMARK_CAPTURE(BM_RepresentablePadding, riscv64, CapFormat::RISCV64);
+
+void BM_FindRepresentableRange(benchmark::State &state, const char *path) {
+  DwarfSource dwsrc{std::filesystem::path(path)};
+  for (auto _ : state) {
+    for (auto length : kLengths)
+      benchmark::DoNotOptimize(dwsrc.findRepresentableRange(0x1004, length));
+  }
+  state.SetItemsProcessed(state.iterations() * kLengths.size());
+}
+BENCHMARK_CAPTURE(BM_FindRepresentableRange, sample_padding,
+                  "assets/sample_padding");
+
+void BM_FindRequiredPrecision(benchmark::State &state, const char *path) {
+  DwarfSource dwsrc{std::filesystem::path(path)};
+  for (auto _ : state) {
+    for (auto length : kLengths)
+      benchmark::DoNotOptimize(dwsrc.findRequiredPrecision(0x1004, length));
+  }
+  state.SetItemsProcessed(state.iterations() * kLengths.size());
+}
+BENCHMARK_CAPTURE(BM_FindRequiredPrecision, sample_padding,
+                  "assets/sample_padding");
+
+void BM_ResolveTypeDie(benchmark::State &state, const char *path) {
+  auto scraper = makeScraper(path);
+  auto dies = collectAggregates(scraper->source());
+  for (auto _ : state) {
+    for (auto &die : dies)
+      benchmark::DoNotOptimize(scraper->resolveTypeDie(die));
+  }
+  state.SetItemsProcessed(state.iterations() * dies.size());
+}
+BENCHMARK_CAPTURE(BM_ResolveTypeDie, sample_padding, "assets/sample_padding");
+BENCHMARK_CAPTURE(BM_ResolveTypeDie, sample_bitfields,
+                  "assets/sample_bitfields");
+BENCHMARK_CAPTURE(BM_ResolveTypeDie, sample_imprecise_member,
+                  "assets/sample_imprecise_member");
+
+void BM_VisitCommon(benchmark::State &state, const char *path) {
+  auto scraper = makeScraper(path);
+  auto dies = collectAggregates(scraper->source());
+  for (auto _ : state) {
+    for (auto &die : dies)
+      benchmark::DoNotOptimize(scraper->visitCommon(die));
+    // Layouts that were already flattened are skipped, so we must drop them.
+    // This is cheap compared to the flattening itself.
+    scraper->clearLayouts();
+  }
+  state.SetItemsProcessed(state.iterations() * dies.size());
+}
+BENCHMARK_CAPTURE(BM_VisitCommon, sample_padding, "assets/sample_padding");
+BENCHMARK_CAPTURE(BM_VisitCommon, sample_nested_struct_vla,
+                  "assets/sample_nested_struct_vla");
+BENCHMARK_CAPTURE(BM_VisitCommon, sample_imprecise_member,
+                  "assets/sample_imprecise_member");
+
+void BM_CheckNestedPadding(benchmark::State &state, const char *path) {
+  auto scraper = makeScraper(path);
+  auto layouts = scraper->flatten(collectAggregates(scraper->source()));
+  for (auto _ : state) {
+    for (auto &layout : layouts) {
+      size_t idx = 0;
+      benchmark::DoNotOptimize(
+          scraper->checkNestedPadding(*layout, idx, nullptr));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * layouts.size());
+}
+BENCHMARK_CAPTURE(BM_CheckNestedPadding, sample_padding,
+                  "assets/sample_padding");
+
+void BM_RecordLayout(benchmark::State &state, const char *path) {
+  auto scraper = makeScraper(path);
+  scraper->initSchema();
+  auto layouts = scraper->flatten(collectAggregates(scraper->source()));
+  if (layouts.empty()) {
+    state.SkipWithError("No layouts found");
+    return;
+  }
+  // Give each copy a fresh line so that we never hit the conflict path.
+  unsigned long long line = 0;
+  for (auto _ : state) {
+    for (auto &layout : layouts) {
+      auto copy = std::make_unique<FlattenedLayout>(*layout);
+      copy->line = ++line;
+      scraper->recordLayout(std::move(copy));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * layouts.size());
+}
+BENCHMARK_CAPTURE(BM_RecordLayout, sample_padding, "assets/sample_padding");
+
+} // namespace
+
+int main(int argc, char **argv) {
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv))
+    return 1;
+
+  int dummy_argc = 0;
+  QCoreApplication app(dummy_argc, nullptr);
+  QCoreApplication::setApplicationName("dwarf-scanner-bench");
+  QCoreApplication::setApplicationVersion("1.0");
+  storage = std::make_unique<StorageManager>(std::filesystem::path(":memory:"));
+
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  storage.reset();
+  return 0;
+}
@@ -0,0 +1,153 @@
+# Performance regression gate, run by ctest with cmake -P.
+#
+# Generate the synthetic corpus with a fixed seed, scan it with the
+# flat-layout scraper and compare the throughput in the JSON run report
+# against the baseline. The best of RUNS scans is used, to reduce noise.
+#
+# Required variables:
+#   CORPUS_GEN       dwarf_corpus_gen executable
+#   SCRAPER          dwarf_scraper executable
+#   WORK_DIR         directory for the corpus, database and reports
+#   BASELINE         baseline JSON file
+# Optional variables:
+#   RUNS             number of scans (default 3)
+#   TOLERANCE        allowed throughput drop, in percent, for the metrics
+#                    added to a new baseline (default 20)
+#   UPDATE_BASELINE  write the measured throughput to BASELINE and pass
+
+foreach (var CORPUS_GEN SCRAPER WORK_DIR BASELINE)
+  if (NOT DEFINED ${var})
+    message(FATAL_ERROR "perf_gate.cmake: missing -D${var}")
+  endif ()
+endforeach ()
+if (NOT DEFINED RUNS)
+  set(RUNS 3)
+endif ()
+if (NOT DEFINED TOLERANCE)
+  set(TOLERANCE 20)
+endif ()
+# Throughput depends on the machine, so there is no default baseline.
+# Without one the gate can not check anything, fail before scanning.
+if (NOT UPDATE_BASELINE AND NOT EXISTS "${BASELINE}")
+  message(FATAL_ERROR "No performance baseline at ${BASELINE}. Record one "
+    "on this machine with -DPERF_UPDATE_BASELINE=ON")
+endif ()
+
+# Throughput metrics from the run report totals, higher is better
+set(METRICS layouts_per_s members_per_s inserts_per_s dies_per_s)
+# Corpus shape, changing this requires a new baseline
+set(CORPUS_ARGS
+  --triple riscv64-unknown-freebsd-purecap
+  --units 64 --structs 64 --members 12 --depth 2
+  --bitfields 2 --vlas 4 --globals 8 --seed 42)
+string(REPLACE ";" " " corpus_id "${CORPUS_ARGS}")
+
+file(MAKE_DIRECTORY "${WORK_DIR}")
+set(corpus "${WORK_DIR}/corpus.elf")
+execute_process(
+  COMMAND "${CORPUS_GEN}" ${CORPUS_ARGS} "${corpus}"
+  RESULT_VARIABLE rc
+  ERROR_VARIABLE gen_log)
+if (NOT rc EQUAL 0)
+  message(FATAL_ERROR "Corpus generation failed (${rc}):\n${gen_log}")
+endif ()
+
+foreach (metric IN LISTS METRICS)
+  set(best_${metric} 0)
+endforeach ()
+foreach (run RANGE 1 ${RUNS})
+  set(report_file "${WORK_DIR}/report-${run}.json")
+  # A single thread keeps the database contention out of the measurement
+  execute_process(
+    COMMAND "${SCRAPER}" --clean --threads 1
+      --database "${WORK_DIR}/perf.sqlite"
+      --report "${report_file}"
+      --input "${corpus}" flat-layout
+    RESULT_VARIABLE rc
+    ERROR_VARIABLE scan_log)
+  if (NOT rc EQUAL 0)
+    message(FATAL_ERROR "Corpus scan failed (${rc}):\n${scan_log}")
+  endif ()
+  file(READ "${report_file}" report)
+  foreach (metric IN LISTS METRICS)
+    string(JSON value GET "${report}" totals throughput ${metric})
+    if (value GREATER best_${metric})
+      set(best_${metric} ${value})
+    endif ()
+  endforeach ()
+endforeach ()
+
+if (UPDATE_BASELINE)
+  set(baseline "{}")
+  string(JSON baseline SET "${baseline}" corpus "\"${corpus_id}\"")
+  string(JSON baseline SET "${baseline}" metrics "{}")
+  foreach (metric IN LISTS METRICS)
+    string(JSON baseline SET "${baseline}" metrics ${metric}
+      "{\"value\": ${best_${metric}}, \"tolerance\": ${TOLERANCE}}")
+  endforeach ()
+  file(WRITE "${BASELINE}" "${baseline}\n")
+  message(STATUS "Updated performance baseline ${BASELINE}")
+  return()
+endif ()
+
+file(READ "${BASELINE}" baseline)
+string(JSON baseline_corpus GET "${baseline}" corpus)
+if (NOT baseline_corpus STREQUAL corpus_id)
+  message(FATAL_ERROR "The baseline was recorded with a different corpus:\n"
+    "  baseline: ${baseline_corpus}\n  current:  ${corpus_id}\n"
+    "Refresh it with -DPERF_UPDATE_BASELINE=ON")
+endif ()
+
+# Left-align a table column
+function(column out value width)
+  string(LENGTH "${value}" len)
+  set(cell "${value}")
+  if (len LESS width)
+    math(EXPR pad "${width} - ${len}")
+    string(REPEAT " " ${pad} spaces)
+    string(APPEND cell "${spaces}")
+  endif ()
+  set(${out} "${${out}}${cell}" PARENT_SCOPE)
+endfunction()
+
+# Compare in integer arithmetic, a metric regresses when
+# measured < baseline * (100 - tolerance) / 100
+set(regressed "")
+set(table "")
+foreach (header metric baseline measured change allowed)
+  column(table ${header} 16)
+endforeach ()
+string(APPEND table "\n")
+foreach (metric IN LISTS METRICS)
+  string(JSON expected ERROR_VARIABLE missing
+    GET "${baseline}" metrics ${metric} value)
+  if (missing)
+    continue()
+  endif ()
+  string(JSON tolerance GET "${baseline}" metrics ${metric} tolerance)
+  set(measured ${best_${metric}})
+  set(change 0)
+  if (expected GREATER 0)
+    math(EXPR change "(${measured} - ${expected}) * 100 / ${expected}")
+  endif ()
+  math(EXPR limit "${expected} * (100 - ${tolerance})")
+  math(EXPR scaled "${measured} * 100")
+  column(table ${metric} 16)
+  column(table ${expected} 16)
+  column(table ${measured} 16)
+  column(table "${change}%" 16)
+  column(table "-${tolerance}%" 16)
+  if (scaled LESS limit)
+    string(APPEND table "REGRESSION")
+    list(APPEND regressed ${metric})
+  endif ()
+  string(APPEND table "\n")
+endforeach ()
+
+# FATAL_ERROR reflows the message, print the table as is
+message(NOTICE "${table}")
+if (regressed)
+  list(JOIN regressed ", " regressed)
+  message(FATAL_ERROR "Throughput regression in ${regressed}. Refresh the "
+    "baseline with -DPERF_UPDATE_BASELINE=ON if the slowdown is expected.")
+endif ()
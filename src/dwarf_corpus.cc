@@ -0,0 +1,659 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Alfredo Mazzinghi
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <format>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/Triple.h>
+#include <llvm/BinaryFormat/Dwarf.h>
+#include <llvm/BinaryFormat/ELF.h>
+#include <llvm/ObjectYAML/DWARFYAML.h>
+#include <llvm/ObjectYAML/ELFYAML.h>
+#include <llvm/ObjectYAML/yaml2obj.h>
+#include <llvm/Support/Allocator.h>
+#include <llvm/Support/ErrorHandling.h>
+#include <llvm/Support/LEB128.h>
+#include <llvm/Support/MathExtras.h>
+#include <llvm/Support/StringSaver.h>
+
+#include "dwarf_corpus.hh"
+
+namespace dwarf = llvm::dwarf;
+namespace ELF = llvm::ELF;
+namespace DWARFYAML = llvm::DWARFYAML;
+namespace ELFYAML = llvm::ELFYAML;
+
+namespace cheri {
+
+namespace {
+
+// Base address of the .bss section that holds the globals
+constexpr uint64_t kBssBase = 0x100000;
+// Size of a DWARF v4 32-bit compilation unit header
+constexpr uint64_t kUnitHeaderSize = 11;
+// Element counts for the array members. The larger ones are not
+// exactly representable by any of the capability formats.
+constexpr std::array<uint64_t, 9> kArrayCounts = {2,   3,    8,    17,    33,
+                                                  100, 1000, 4097, 0x4001};
+
+enum AbbrevCode : uint32_t {
+  kAbbrevUnit = 1,
+  kAbbrevBaseType,
+  kAbbrevPointer,
+  kAbbrevStruct,
+  kAbbrevMember,
+  kAbbrevBitfield,
+  kAbbrevArray,
+  kAbbrevSubrange,
+  kAbbrevFlexSubrange,
+  kAbbrevVariable,
+};
+
+enum class ScalarKind { Char, Short, Int, Long, Pointer, Count };
+
+/*
+ * ELF and ABI parameters of the corpus target.
+ */
+struct CorpusTarget {
+  CapFormat format;
+  uint16_t machine;
+  bool is_64bit;
+  uint32_t flags;
+  uint64_t addr_size;
+  uint64_t pointer_size;
+};
+
+CorpusTarget parseTarget(const std::string &name) {
+  llvm::Triple triple(name);
+  CorpusTarget target;
+  uint64_t cap_size;
+
+  switch (triple.getArch()) {
+  case llvm::Triple::aarch64:
+    target.format = CapFormat::Morello;
+    target.machine = ELF::EM_AARCH64;
+    target.is_64bit = true;
+    cap_size = 16;
+    break;
+  case llvm::Triple::riscv64:
+    target.format = CapFormat::RISCV128;
+    target.machine = ELF::EM_RISCV;
+    target.is_64bit = true;
+    cap_size = 16;
+    break;
+  case llvm::Triple::riscv32:
+    target.format = CapFormat::RISCV64;
+    target.machine = ELF::EM_RISCV;
+    target.is_64bit = false;
+    cap_size = 8;
+    break;
+  default:
+    throw std::runtime_error(
+        std::format("Unsupported corpus target triple {}", name));
+  }
+
+  target.addr_size = target.is_64bit ? 8 : 4;
+  target.pointer_size = target.addr_size;
+  target.flags = 0;
+  if (triple.getEnvironment() == llvm::Triple::CheriPurecap) {
+    target.pointer_size = cap_size;
+    target.flags = (target.machine == ELF::EM_AARCH64)
+                       ? ELF::EF_AARCH64_CHERI_PURECAP
+                       : ELF::EF_RISCV_CHERIABI;
+  }
+  return target;
+}
+
+/*
+ * Planned structure member, the offsets are computed before emitting
+ * the DIEs so that all type references point backwards.
+ */
+struct MemberPlan {
+  enum class Kind { Scalar, Array, Nested, Bitfield, Flexible };
+
+  Kind kind = Kind::Scalar;
+  ScalarKind scalar = ScalarKind::Int;
+  // Element count for arrays, or the nested structure index
+  uint64_t count = 0;
+  // Byte offset, or bit offset for bitfields
+  uint64_t offset = 0;
+  uint64_t bit_size = 0;
+};
+
+struct StructPlan {
+  std::vector<MemberPlan> members;
+  uint64_t size = 0;
+  uint64_t align = 1;
+};
+
+/*
+ * Build the ELFYAML description of the corpus.
+ * We compute the DIE offsets as we go, as DWARFYAML expects the ref4
+ * values to be resolved already.
+ */
+class CorpusBuilder {
+public:
+  CorpusBuilder(const CorpusConfig &config, const CorpusTarget &target)
+      : config_(config), target_(target), saver_(alloc_), rng_(config.seed),
+        str_size_(0), unit_offset_(0), bss_size_(0) {
+    summary_.format = target.format;
+    initAbbrevs();
+  }
+
+  CorpusSummary build(ELFYAML::Object &doc);
+
+private:
+  void initAbbrevs();
+  uint64_t intern(const std::string &str);
+  uint64_t addEntry(DWARFYAML::Unit &unit, AbbrevCode code,
+                    std::vector<DWARFYAML::FormValue> values);
+  void endChildren(DWARFYAML::Unit &unit);
+  std::vector<StructPlan> planUnit();
+  void buildUnit(unsigned long index, DWARFYAML::Unit &unit,
+                 std::vector<ELFYAML::Symbol> &symbols);
+
+  uint64_t scalarSize(ScalarKind kind) const {
+    switch (kind) {
+    case ScalarKind::Char:
+      return 1;
+    case ScalarKind::Short:
+      return 2;
+    case ScalarKind::Int:
+      return 4;
+    case ScalarKind::Long:
+      return target_.addr_size;
+    case ScalarKind::Pointer:
+      return target_.pointer_size;
+    default:
+      llvm_unreachable("Invalid scalar kind");
+    }
+  }
+
+  const CorpusConfig &config_;
+  const CorpusTarget &target_;
+  CorpusSummary summary_;
+  llvm::BumpPtrAllocator alloc_;
+  llvm::StringSaver saver_;
+  std::mt19937_64 rng_;
+
+  DWARFYAML::AbbrevTable abbrevs_;
+  std::vector<llvm::StringRef> strings_;
+  llvm::StringMap<uint64_t> str_offsets_;
+  uint64_t str_size_;
+  // Offset of the next DIE in the current unit
+  uint64_t unit_offset_;
+  uint64_t bss_size_;
+};
+
+DWARFYAML::FormValue formValue(uint64_t value) {
+  DWARFYAML::FormValue fv;
+  fv.Value = value;
+  return fv;
+}
+
+void CorpusBuilder::initAbbrevs() {
+  using Attrs = std::vector<DWARFYAML::AttributeAbbrev>;
+  auto add = [this](AbbrevCode code, dwarf::Tag tag, bool children,
+                    Attrs attrs) {
+    DWARFYAML::Abbrev abbrev;
+    abbrev.Code = llvm::yaml::Hex64(code);
+    abbrev.Tag = tag;
+    abbrev.Children = children ? dwarf::DW_CHILDREN_yes : dwarf::DW_CHILDREN_no;
+    abbrev.Attributes = std::move(attrs);
+    abbrevs_.Table.push_back(std::move(abbrev));
+  };
+
+  // clang-format off
+  add(kAbbrevUnit, dwarf::DW_TAG_compile_unit, true, {
+      {dwarf::DW_AT_producer, dwarf::DW_FORM_strp, 0},
+      {dwarf::DW_AT_language, dwarf::DW_FORM_data2, 0},
+      {dwarf::DW_AT_name, dwarf::DW_FORM_strp, 0},
+      {dwarf::DW_AT_stmt_list, dwarf::DW_FORM_sec_offset, 0},
+      {dwarf::DW_AT_comp_dir, dwarf::DW_FORM_strp, 0}});
+  add(kAbbrevBaseType, dwarf::DW_TAG_base_type, false, {
+      {dwarf::DW_AT_name, dwarf::DW_FORM_strp, 0},
+      {dwarf::DW_AT_encoding, dwarf::DW_FORM_data1, 0},
+      {dwarf::DW_AT_byte_size, dwarf::DW_FORM_data1, 0}});
+  add(kAbbrevPointer, dwarf::DW_TAG_pointer_type, false, {
+      {dwarf::DW_AT_byte_size, dwarf::DW_FORM_data1, 0}});
+  add(kAbbrevStruct, dwarf::DW_TAG_structure_type, true, {
+      {dwarf::DW_AT_name, dwarf::DW_FORM_strp, 0},
+      {dwarf::DW_AT_byte_size, dwarf::DW_FORM_data4, 0},
+      {dwarf::DW_AT_decl_file, dwarf::DW_FORM_data4, 0},
+      {dwarf::DW_AT_decl_line, dwarf::DW_FORM_data4, 0}});
+  add(kAbbrevMember, dwarf::DW_TAG_member, false, {
+      {dwarf::DW_AT_name, dwarf::DW_FORM_strp, 0},
+      {dwarf::DW_AT_type, dwarf::DW_FORM_ref4, 0},
+      {dwarf::DW_AT_decl_file, dwarf::DW_FORM_data4, 0},
+      {dwarf::DW_AT_decl_line, dwarf::DW_FORM_data4, 0},
+      {dwarf::DW_AT_data_member_location, dwarf::DW_FORM_data4, 0}});
+  add(kAbbrevBitfield, dwarf::DW_TAG_member, false, {
+      {dwarf::DW_AT_name, dwarf::DW_FORM_strp, 0},
+      {dwarf::DW_AT_type, dwarf::DW_FORM_ref4, 0},
+      {dwarf::DW_AT_decl_file, dwarf::DW_FORM_data4, 0},
+      {dwarf::DW_AT_decl_line, dwarf::DW_FORM_data4, 0},
+      {dwarf::DW_AT_bit_size, dwarf::DW_FORM_data1, 0},
+      {dwarf::DW_AT_data_bit_offset, dwarf::DW_FORM_data4, 0}});
+  add(kAbbrevArray, dwarf::DW_TAG_array_type, true, {
+      {dwarf::DW_AT_type, dwarf::DW_FORM_ref4, 0}});
+  add(kAbbrevSubrange, dwarf::DW_TAG_subrange_type, false, {
+      {dwarf::DW_AT_count, dwarf::DW_FORM_data4, 0}});
+  add(kAbbrevFlexSubrange, dwarf::DW_TAG_subrange_type, false, {});
+  add(kAbbrevVariable, dwarf::DW_TAG_variable, false, {
+      {dwarf::DW_AT_name, dwarf::DW_FORM_strp, 0},
+      {dwarf::DW_AT_type, dwarf::DW_FORM_ref4, 0},
+      {dwarf::DW_AT_external, dwarf::DW_FORM_flag_present, 0},
+      {dwarf::DW_AT_decl_file, dwarf::DW_FORM_data4, 0},
+      {dwarf::DW_AT_decl_line, dwarf::DW_FORM_data4, 0},
+      {dwarf::DW_AT_location, dwarf::DW_FORM_exprloc, 0}});
+  // clang-format on
+}
+
+uint64_t CorpusBuilder::intern(const std::string &str) {
+  auto [it, inserted] = str_offsets_.try_emplace(str, str_size_);
+  if (inserted) {
+    strings_.push_back(saver_.save(str));
+    str_size_ += str.size() + 1;
+  }
+  return it->second;
+}
+
+/*
+ * Append a DIE to the unit and return its offset.
+ */
+uint64_t CorpusBuilder::addEntry(DWARFYAML::Unit &unit, AbbrevCode code,
+                                 std::vector<DWARFYAML::FormValue> values) {
+  const auto &abbrev = abbrevs_.Table[code - 1];
+  assert(abbrev.Attributes.size() == values.size() &&
+         "Mismatching DIE attributes");
+
+  uint64_t offset = unit_offset_;
+  unit_offset_ += llvm::getULEB128Size(code);
+  for (size_t i = 0; i < values.size(); i++) {
+    switch (abbrev.Attributes[i].Form) {
+    case dwarf::DW_FORM_flag_present:
+      break;
+    case dwarf::DW_FORM_data1:
+      unit_offset_ += 1;
+      break;
+    case dwarf::DW_FORM_data2:
+      unit_offset_ += 2;
+      break;
+    case dwarf::DW_FORM_data4:
+    case dwarf::DW_FORM_ref4:
+    case dwarf::DW_FORM_strp:
+    case dwarf::DW_FORM_sec_offset:
+      unit_offset_ += 4;
+      break;
+    case dwarf::DW_FORM_exprloc: {
+      auto length = values[i].BlockData.size();
+      unit_offset_ += llvm::getULEB128Size(length) + length;
+      break;
+    }
+    default:
+      llvm_unreachable("Unexpected corpus DIE form");
+    }
+  }
+
+  DWARFYAML::Entry entry;
+  entry.AbbrCode = code;
+  entry.Values = std::move(values);
+  unit.Entries.push_back(std::move(entry));
+  summary_.dies++;
+  return offset;
+}
+
+void CorpusBuilder::endChildren(DWARFYAML::Unit &unit) {
+  DWARFYAML::Entry entry;
+  entry.AbbrCode = 0;
+  unit.Entries.push_back(std::move(entry));
+  unit_offset_ += 1;
+}
+
+/*
+ * Pick the members of the unit structures and compute their layout.
+ * Structure j nests structure j - 1 when it is not at the bottom level,
+ * so nesting chains are at most depth structures long.
+ */
+std::vector<StructPlan> CorpusBuilder::planUnit() {
+  std::vector<StructPlan> plans(config_.structs);
+  std::uniform_int_distribution<int> kind_dist(
+      0, static_cast<int>(ScalarKind::Count));
+  std::uniform_int_distribution<size_t> count_dist(0, kArrayCounts.size() - 1);
+  std::uniform_int_distribution<uint64_t> bits_dist(1, 7);
+
+  for (unsigned long j = 0; j < config_.structs; j++) {
+    auto &plan = plans[j];
+    uint64_t offset = 0;
+    auto place = [&](MemberPlan m, uint64_t size, uint64_t align) {
+      offset = llvm::alignTo(offset, align);
+      m.offset = offset;
+      offset += size;
+      plan.align = std::max(plan.align, align);
+      plan.members.push_back(m);
+    };
+
+    if (j < config_.conflicts) {
+      // Same shape in every unit, only the member names differ
+      for (unsigned long k = 0; k < config_.members; k++)
+        place(MemberPlan(), scalarSize(ScalarKind::Int), 4);
+      plan.size = llvm::alignTo(offset, plan.align);
+      continue;
+    }
+
+    for (unsigned long k = 0; k < config_.members; k++) {
+      MemberPlan m;
+      auto kind = kind_dist(rng_);
+      if (kind == static_cast<int>(ScalarKind::Count)) {
+        m.kind = MemberPlan::Kind::Array;
+        m.scalar = ScalarKind::Char;
+        m.count = kArrayCounts[count_dist(rng_)];
+        place(m, m.count, 1);
+      } else {
+        m.scalar = static_cast<ScalarKind>(kind);
+        auto size = scalarSize(m.scalar);
+        place(m, size, size);
+      }
+    }
+
+    if (config_.depth > 0 && j % (config_.depth + 1) != 0) {
+      MemberPlan m;
+      m.kind = MemberPlan::Kind::Nested;
+      m.count = j - 1;
+      place(m, plans[j - 1].size, plans[j - 1].align);
+    }
+
+    if (config_.bitfields > 0) {
+      // Pack the bitfields in int storage units
+      uint64_t bit_offset = llvm::alignTo(offset, 4) * 8;
+      for (unsigned long k = 0; k < config_.bitfields; k++) {
+        MemberPlan m;
+        m.kind = MemberPlan::Kind::Bitfield;
+        m.bit_size = bits_dist(rng_);
+        if (bit_offset % 32 + m.bit_size > 32)
+          bit_offset = llvm::alignTo(bit_offset, 32);
+        m.offset = bit_offset;
+        bit_offset += m.bit_size;
+        plan.members.push_back(m);
+      }
+      offset = llvm::divideCeil(bit_offset, 8);
+      plan.align = std::max<uint64_t>(plan.align, 4);
+    }
+
+    if (j < config_.vlas) {
+      MemberPlan m;
+      m.kind = MemberPlan::Kind::Flexible;
+      m.scalar = ScalarKind::Char;
+      place(m, 0, 1);
+    }
+    plan.size = llvm::alignTo(offset, plan.align);
+  }
+  return plans;
+}
+
+void CorpusBuilder::buildUnit(unsigned long index, DWARFYAML::Unit &unit,
+                              std::vector<ELFYAML::Symbol> &symbols) {
+  unit.Format = dwarf::DWARF32;
+  unit.Version = 4;
+  unit.AddrSize = static_cast<uint8_t>(target_.addr_size);
+  unit.Type = dwarf::DW_UT_compile;
+  // All the units share the abbreviation table
+  unit.AbbrevTableID = 0;
+  unit_offset_ = kUnitHeaderSize;
+
+  auto plans = planUnit();
+  // Each unit has its own file in the shared line table
+  uint64_t file = index + 1;
+
+  addEntry(unit, kAbbrevUnit,
+           {formValue(intern("dwarf-corpus-gen")),
+            formValue(dwarf::DW_LANG_C11),
+            formValue(intern(std::format("unit{}.c", index))), formValue(0),
+            formValue(intern("/corpus"))});
+
+  std::array<uint64_t, static_cast<size_t>(ScalarKind::Count)> scalars;
+  auto base_type = [&](ScalarKind kind, const char *name, uint64_t encoding) {
+    scalars[static_cast<size_t>(kind)] =
+        addEntry(unit, kAbbrevBaseType,
+                 {formValue(intern(name)), formValue(encoding),
+                  formValue(scalarSize(kind))});
+  };
+  base_type(ScalarKind::Char, "char", dwarf::DW_ATE_signed_char);
+  base_type(ScalarKind::Short, "short", dwarf::DW_ATE_signed);
+  base_type(ScalarKind::Int, "int", dwarf::DW_ATE_signed);
+  base_type(ScalarKind::Long, "long", dwarf::DW_ATE_signed);
+  scalars[static_cast<size_t>(ScalarKind::Pointer)] = addEntry(
+      unit, kAbbrevPointer,
+      {formValue(scalarSize(ScalarKind::Pointer))});
+  auto char_type = scalars[static_cast<size_t>(ScalarKind::Char)];
+
+  // Array types used by the unit, keyed by element count.
+  // Flexible arrays use count 0.
+  std::map<uint64_t, uint64_t> arrays;
+  for (auto &plan : plans) {
+    for (auto &m : plan.members) {
+      if (m.kind == MemberPlan::Kind::Array)
+        arrays.emplace(m.count, 0);
+      else if (m.kind == MemberPlan::Kind::Flexible)
+        arrays.emplace(0, 0);
+    }
+  }
+  for (auto &[count, offset] : arrays) {
+    offset = addEntry(unit, kAbbrevArray, {formValue(char_type)});
+    if (count == 0)
+      addEntry(unit, kAbbrevFlexSubrange, {});
+    else
+      addEntry(unit, kAbbrevSubrange, {formValue(count)});
+    endChildren(unit);
+  }
+
+  std::vector<uint64_t> structs;
+  for (unsigned long j = 0; j < plans.size(); j++) {
+    auto &plan = plans[j];
+    bool conflict = j < config_.conflicts;
+    uint64_t line = j + 1;
+    // The conflicting structures are in the header after the unit files
+    uint64_t decl_file = conflict ? config_.units + 1 : file;
+    auto struct_name = conflict ? std::format("shared{}", j)
+                                : std::format("s{}_{}", index, j);
+    structs.push_back(addEntry(
+        unit, kAbbrevStruct,
+        {formValue(intern(struct_name)), formValue(plan.size),
+         formValue(decl_file), formValue(line)}));
+
+    for (unsigned long k = 0; k < plan.members.size(); k++) {
+      auto &m = plan.members[k];
+      uint64_t type;
+      switch (m.kind) {
+      case MemberPlan::Kind::Scalar:
+        type = scalars[static_cast<size_t>(m.scalar)];
+        break;
+      case MemberPlan::Kind::Array:
+        type = arrays[m.count];
+        break;
+      case MemberPlan::Kind::Nested:
+        type = structs[m.count];
+        break;
+      case MemberPlan::Kind::Bitfield:
+        type = scalars[static_cast<size_t>(ScalarKind::Int)];
+        break;
+      case MemberPlan::Kind::Flexible:
+        type = arrays[0];
+        break;
+      }
+      auto name = formValue(intern(conflict ? std::format("u{}_m{}", index, k)
+                                            : std::format("m{}", k)));
+      if (m.kind == MemberPlan::Kind::Bitfield) {
+        addEntry(unit, kAbbrevBitfield,
+                 {name, formValue(type), formValue(decl_file), formValue(line),
+                  formValue(m.bit_size), formValue(m.offset)});
+      } else {
+        addEntry(unit, kAbbrevMember,
+                 {name, formValue(type), formValue(decl_file), formValue(line),
+                  formValue(m.offset)});
+      }
+    }
+    endChildren(unit);
+    summary_.layouts++;
+    summary_.members += plan.members.size();
+  }
+
+  for (unsigned long g = 0; g < config_.globals; g++) {
+    uint64_t type, size, align;
+    if (plans.empty()) {
+      type = scalars[static_cast<size_t>(ScalarKind::Int)];
+      size = align = 4;
+    } else {
+      auto &plan = plans[g % plans.size()];
+      type = structs[g % plans.size()];
+      size = plan.size;
+      align = plan.align;
+    }
+    bss_size_ = llvm::alignTo(bss_size_, std::max<uint64_t>(align, 16));
+    uint64_t addr = kBssBase + bss_size_;
+    bss_size_ += std::max<uint64_t>(size, 1);
+
+    DWARFYAML::FormValue location;
+    location.BlockData.push_back(dwarf::DW_OP_addr);
+    for (uint64_t i = 0; i < target_.addr_size; i++)
+      location.BlockData.push_back((addr >> (8 * i)) & 0xff);
+
+    auto name = std::format("g{}_{}", index, g);
+    addEntry(unit, kAbbrevVariable,
+             {formValue(intern(name)), formValue(type), formValue(0),
+              formValue(file), formValue(config_.structs + g + 1),
+              std::move(location)});
+
+    ELFYAML::Symbol sym;
+    sym.Name = saver_.save(name);
+    sym.Type = ELFYAML::ELF_STT(ELF::STT_OBJECT);
+    sym.Section = llvm::StringRef(".bss");
+    sym.Binding = ELFYAML::ELF_STB(ELF::STB_GLOBAL);
+    sym.Value = llvm::yaml::Hex64(addr);
+    sym.Size = llvm::yaml::Hex64(size);
+    symbols.push_back(std::move(sym));
+    summary_.globals++;
+  }
+  endChildren(unit);
+}
+
+CorpusSummary CorpusBuilder::build(ELFYAML::Object &doc) {
+  doc.DWARF.emplace();
+  auto &dwarf_data = *doc.DWARF;
+  dwarf_data.IsLittleEndian = true;
+  dwarf_data.Is64BitAddrSize = target_.is_64bit;
+
+  // All the units share a line table, unit N is described by file N + 1.
+  DWARFYAML::LineTable lines;
+  lines.Format = dwarf::DWARF32;
+  lines.Version = 4;
+  lines.MinInstLength = 1;
+  lines.MaxOpsPerInst = 1;
+  lines.DefaultIsStmt = 1;
+  lines.LineBase = static_cast<uint8_t>(-5);
+  lines.LineRange = 14;
+  lines.OpcodeBase = 13;
+  lines.StandardOpcodeLengths = {0, 1, 1, 1, 1, 0, 0, 0, 1, 0, 0, 1};
+  lines.IncludeDirs.push_back("/corpus");
+
+  std::vector<ELFYAML::Symbol> symbols;
+  dwarf_data.CompileUnits.resize(config_.units);
+  for (unsigned long i = 0; i < config_.units; i++) {
+    DWARFYAML::File file;
+    file.Name = saver_.save(std::format("unit{}.c", i));
+    file.DirIdx = 1;
+    file.ModTime = 0;
+    file.Length = 0;
+    lines.Files.push_back(file);
+    buildUnit(i, dwarf_data.CompileUnits[i], symbols);
+  }
+  if (config_.conflicts > 0) {
+    DWARFYAML::File header;
+    header.Name = "shared.h";
+    header.DirIdx = 1;
+    header.ModTime = 0;
+    header.Length = 0;
+    lines.Files.push_back(header);
+  }
+  dwarf_data.DebugLines.push_back(std::move(lines));
+  abbrevs_.ID = 0;
+  dwarf_data.DebugAbbrev.push_back(abbrevs_);
+  dwarf_data.DebugStrings = strings_;
+
+  doc.Header.Class = ELFYAML::ELF_ELFCLASS(target_.is_64bit ? ELF::ELFCLASS64
+                                                            : ELF::ELFCLASS32);
+  doc.Header.Data = ELFYAML::ELF_ELFDATA(ELF::ELFDATA2LSB);
+  doc.Header.OSABI = ELFYAML::ELF_ELFOSABI(ELF::ELFOSABI_NONE);
+  doc.Header.ABIVersion = 0;
+  doc.Header.Type = ELFYAML::ELF_ET(ELF::ET_EXEC);
+  doc.Header.Machine = ELFYAML::ELF_EM(target_.machine);
+  doc.Header.Flags = ELFYAML::ELF_EF(target_.flags);
+  doc.Header.Entry = 0;
+
+  auto bss = std::make_unique<ELFYAML::NoBitsSection>();
+  bss->Name = ".bss";
+  bss->Type = ELFYAML::ELF_SHT(ELF::SHT_NOBITS);
+  bss->Flags = ELFYAML::ELF_SHF(ELF::SHF_ALLOC | ELF::SHF_WRITE);
+  bss->Address = llvm::yaml::Hex64(kBssBase);
+  bss->AddressAlign = 16;
+  bss->Size = llvm::yaml::Hex64(bss_size_);
+  doc.Chunks.push_back(std::move(bss));
+  // The ELF emitter expects the section header table to be the last chunk
+  doc.Chunks.push_back(
+      std::make_unique<ELFYAML::SectionHeaderTable>(/*IsImplicit=*/true));
+  doc.Symbols = std::move(symbols);
+
+  return summary_;
+}
+
+} // namespace
+
+CorpusSummary generateCorpus(const CorpusConfig &config,
+                             llvm::raw_ostream &os) {
+  auto target = parseTarget(config.triple);
+  CorpusBuilder builder(config, target);
+  ELFYAML::Object doc;
+  auto summary = builder.build(doc);
+
+  std::string error;
+  auto handler = [&error](const llvm::Twine &msg) { error = msg.str(); };
+  if (!llvm::yaml::yaml2elf(doc, os, handler, UINT64_MAX)) {
+    throw std::runtime_error(
+        std::format("Failed to emit the DWARF corpus: {}", error));
+  }
+  return summary;
+}
+
+} /* namespace cheri */
@@ -0,0 +1,102 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Alfredo Mazzinghi
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include <llvm/Support/raw_ostream.h>
+
+#include "scraper.hh"
+
+namespace cheri {
+
+/**
+ * Shape of a synthetic DWARF corpus.
+ * Every compilation unit gets the same number of structures and globals,
+ * the member types are picked by a PRNG seeded with the given seed, so
+ * the output is reproducible.
+ */
+struct CorpusConfig {
+  CorpusConfig()
+      : triple("riscv64-unknown-freebsd-purecap"), units(1), structs(16),
+        members(8), depth(2), bitfields(0), vlas(0), globals(0), conflicts(0),
+        seed(0) {}
+
+  // Target triple, the architecture selects the capability format and
+  // the purecap environment makes pointers capability-sized.
+  std::string triple;
+  // Number of compilation units
+  unsigned long units;
+  // Structures per compilation unit
+  unsigned long structs;
+  // Scalar and array members per structure
+  unsigned long members;
+  // Maximum nesting depth of structure members
+  unsigned long depth;
+  // Bitfield members per structure
+  unsigned long bitfields;
+  // Structures per compilation unit that end with a flexible array member
+  unsigned long vlas;
+  // Global variables per compilation unit
+  unsigned long globals;
+  // Structures per compilation unit that every unit declares at the same
+  // location of a shared header, with the same size but different member
+  // names, as an ODR violation would.
+  unsigned long conflicts;
+  uint64_t seed;
+};
+
+/**
+ * Summary of the generated corpus.
+ */
+struct CorpusSummary {
+  CorpusSummary()
+      : format(CapFormat::RISCV128), layouts(0), members(0), globals(0),
+        dies(0) {}
+
+  CapFormat format;
+  // Top-level structure layouts
+  unsigned long layouts;
+  // Direct structure members
+  unsigned long members;
+  unsigned long globals;
+  // Total number of DIEs, excluding the null entries
+  unsigned long dies;
+};
+
+/**
+ * Emit an ELF file with the DWARF described by the configuration.
+ * This uses the ObjectYAML ELF emitter, so no toolchain is needed.
+ * Throws std::runtime_error if the triple is not a CHERI target or the
+ * object can not be emitted.
+ */
+CorpusSummary generateCorpus(const CorpusConfig &config, llvm::raw_ostream &os);
+
+} // namespace cheri
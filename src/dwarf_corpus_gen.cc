@@ -0,0 +1,138 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Alfredo Mazzinghi
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+
+#include <llvm/Support/raw_ostream.h>
+
+#include "dwarf_corpus.hh"
+
+int main(int argc, char **argv) {
+  using namespace cheri;
+
+  QCoreApplication app(argc, argv);
+  QCoreApplication::setApplicationName("dwarf-corpus-gen");
+  QCoreApplication::setApplicationVersion("1.0");
+
+  CorpusConfig config;
+  QCommandLineParser parser;
+  parser.setApplicationDescription(
+      "Generate a synthetic CHERI DWARF corpus for scale testing");
+  parser.addHelpOption();
+  parser.addVersionOption();
+
+  QCommandLineOption triple(
+      "triple",
+      "Target triple, selects the capability format. Use the purecap "
+      "environment for capability-sized pointers",
+      "TRIPLE", QString::fromStdString(config.triple));
+  parser.addOption(triple);
+
+  // Numeric options, in the same order as the CorpusConfig fields
+  struct NumericOption {
+    QCommandLineOption option;
+    unsigned long *value;
+  };
+  std::vector<NumericOption> numeric = {
+      {{"units", "Number of compilation units", "N", "1"}, &config.units},
+      {{"structs", "Structures per compilation unit", "N", "16"},
+       &config.structs},
+      {{"members", "Scalar and array members per structure", "N", "8"},
+       &config.members},
+      {{"depth", "Maximum structure nesting depth", "N", "2"}, &config.depth},
+      {{"bitfields", "Bitfield members per structure", "N", "0"},
+       &config.bitfields},
+      {{"vlas",
+        "Structures per compilation unit ending with a flexible array member",
+        "N", "0"},
+       &config.vlas},
+      {{"globals", "Global variables per compilation unit", "N", "0"},
+       &config.globals},
+      {{"conflicts",
+        "Structures per compilation unit redefined by every unit in a "
+        "shared header, with different member names",
+        "N", "0"},
+       &config.conflicts},
+  };
+  for (auto &opt : numeric)
+    parser.addOption(opt.option);
+
+  QCommandLineOption seed("seed", "Seed for the member type selection", "SEED",
+                          "0");
+  parser.addOption(seed);
+
+  parser.addPositionalArgument("output", "Output ELF file");
+  parser.process(app);
+
+  auto args = parser.positionalArguments();
+  if (args.size() != 1) {
+    qCritical() << "Missing positional argument 'output'";
+    parser.showHelp(1);
+  }
+
+  config.triple = parser.value(triple).toStdString();
+  bool ok;
+  for (auto &opt : numeric) {
+    *opt.value = parser.value(opt.option).toULong(&ok);
+    if (!ok) {
+      qCritical() << "Invalid value for option" << opt.option.names().first()
+                  << "must be an integer:" << parser.value(opt.option);
+      return 1;
+    }
+  }
+  config.seed = parser.value(seed).toULongLong(&ok);
+  if (!ok) {
+    qCritical() << "Invalid value for option --seed, must be an integer:"
+                << parser.value(seed);
+    return 1;
+  }
+
+  std::error_code ec;
+  llvm::raw_fd_ostream os(args[0].toStdString(), ec);
+  if (ec) {
+    qCritical() << "Can not open output file" << args[0] << ec.message();
+    return 1;
+  }
+
+  try {
+    auto summary = generateCorpus(config, os);
+    qInfo() << "Generated" << summary.layouts << "layouts with"
+            << summary.members << "members and" << summary.globals
+            << "globals," << summary.dies << "DIEs";
+  } catch (std::runtime_error &ex) {
+    qCritical() << ex.what();
+    return 1;
+  }
+  return 0;
+}
@@ -25,9 +25,13 @@
  * SUCH DAMAGE.
  */
 
+#include <algorithm>
+#include <bit>
+#include <chrono>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <map>
 #include <mutex>
 #include <stdexcept>
 #include <string>
@@ -41,9 +45,19 @@
 #include <QtLogging>
 
 #include "flat_layout_scraper.hh"
+#include "global_placement.hh"
 #include "global_sym_scraper.hh"
+#include "heap_classes.hh"
+#include "layout_compare.hh"
+#include "layout_index.hh"
+#include "layout_snapshot.hh"
 #include "pool.hh"
+#include "progress.hh"
+#include "run_report.hh"
 #include "scraper.hh"
+#include "stack_frame_scraper.hh"
+#include "top_layouts.hh"
+#include "trace.hh"
 #include "utils.hh"
 
 namespace fs = std::filesystem;
@@ -54,7 +68,7 @@ namespace {
  * Maps command line arguments to an internal identifier for
  * a specific scraper.
  */
-enum class ScraperID { FlatLayout, GlobalSym, Unset };
+enum class ScraperID { FlatLayout, GlobalSym, StackFrame, Unset };
 
 /**
  * Log stream, can be a file or stderr.
@@ -70,6 +84,9 @@ std::ostream &operator<<(std::ostream &os, const ScraperID &value) {
   case ScraperID::GlobalSym:
     os << "global-sym";
     break;
+  case ScraperID::StackFrame:
+    os << "stack-frame";
+    break;
   default:
     os << "<unknown-scraper>";
   }
@@ -81,6 +98,8 @@ template <typename T> ScraperID scraperNameToID(const T &name) {
     return ScraperID::FlatLayout;
   } else if (name == "global-sym") {
     return ScraperID::GlobalSym;
+  } else if (name == "stack-frame") {
+    return ScraperID::StackFrame;
   } else {
     return ScraperID::Unset;
   }
@@ -95,6 +114,116 @@ void logHandler(QtMsgType type, const QMessageLogContext &context,
     *log_stream << message.toStdString() << std::endl;
 }
 
+/**
+ * Compare the layouts in two databases produced by scanning two builds
+ * of the same sources.
+ */
+int runCompare(fs::path base_db, fs::path other_db) {
+  cheri::LayoutSnapshot base(base_db);
+  cheri::LayoutSnapshot other(other_db);
+  cheri::LayoutComparator comparator(base, other);
+
+  qInfo() << "Comparing layouts in" << base_db << "against" << other_db;
+  auto deltas = comparator.compare();
+  cheri::writeCompareReport(std::cout, deltas);
+  if (comparator.unmatched()) {
+    qInfo() << comparator.unmatched() << "layouts in" << base_db
+            << "have no match in" << other_db;
+  }
+  return 0;
+}
+
+/**
+ * Show the layouts that changed between two databases.
+ */
+int runDiff(fs::path base_db, fs::path other_db) {
+  cheri::LayoutSnapshot base(base_db);
+  cheri::LayoutSnapshot other(other_db);
+  cheri::LayoutDiffer differ(base, other);
+
+  qInfo() << "Diff layouts in" << base_db << "against" << other_db;
+  auto diffs = differ.diff();
+  cheri::writeDiffReport(std::cout, diffs);
+  qInfo() << diffs.size() << "layouts differ," << differ.unchanged()
+          << "unchanged";
+  return 0;
+}
+
+/**
+ * Suggest a placement of the global symbols of a binary and write it as
+ * a symbol ordering file.
+ */
+int runPlace(fs::path db, std::optional<std::string> binary,
+             fs::path ordering_file) {
+  cheri::LayoutSnapshot snapshot(db);
+
+  qInfo() << "Placing global symbols in" << db;
+  auto symbols = cheri::loadPlacementSymbols(snapshot, binary);
+  auto placements = cheri::placeSymbols(symbols);
+
+  std::ofstream out(ordering_file);
+  if (!out) {
+    qCritical() << "Can not open ordering file" << ordering_file;
+    return 1;
+  }
+  cheri::writeOrderingFile(out, symbols, placements);
+  cheri::writePlacementReport(std::cout, placements);
+  return 0;
+}
+
+/**
+ * Predict the heap size class and bounds precision of every layout
+ * in the database.
+ */
+int runHeapClasses(fs::path db, fs::path size_classes, cheri::CapFormat format,
+                   unsigned long workers) {
+  // Large allocations are rounded to whole pages
+  constexpr uint64_t kPageSize = 4096;
+
+  std::ifstream table(size_classes);
+  if (!table) {
+    qCritical() << "Can not open size class table" << size_classes;
+    return 1;
+  }
+  auto classes = cheri::parseSizeClasses(table, kPageSize);
+  qInfo() << "Loaded" << classes.size() << "size classes from" << size_classes;
+
+  cheri::LayoutSnapshot snapshot(db);
+  snapshot.loadLayouts();
+  snapshot.loadMembers();
+
+  auto results = cheri::analyzeHeapClasses(snapshot.layouts(), classes, format,
+                                           kPageSize, workers);
+  cheri::writeHeapClassReport(std::cout, std::move(results));
+  return 0;
+}
+
+/**
+ * Annotate (type, offset) trace records with the member at each offset.
+ */
+int runAnnotate(fs::path db, std::optional<fs::path> trace) {
+  constexpr size_t kBatchSize = 4096;
+  cheri::LayoutSnapshot snapshot(db);
+  snapshot.loadLayouts();
+  snapshot.loadMembers();
+  cheri::LayoutIndex index(snapshot);
+  qInfo() << "Indexed" << index.size() << "layouts from" << db;
+
+  unsigned long long count = 0;
+  if (trace) {
+    std::ifstream in(*trace);
+    if (!in) {
+      qCritical() << "Can not open trace file" << *trace;
+      return 1;
+    }
+    count = cheri::annotateRecords(in, std::cout, index, kBatchSize);
+  } else {
+    count = cheri::annotateRecords(std::cin, std::cout, index, kBatchSize);
+  }
+  qInfo() << "Annotated" << count << "records";
+  return 0;
+}
+
 /**
  * Helper context for the scraping session
  */
@@ -102,16 +231,57 @@ class Driver {
 public:
   Driver(unsigned long workers, fs::path db_file,
          std::optional<std::string> path_strip_prefix)
-      : pool_(workers), sm_(db_file), strip_prefix_(path_strip_prefix) {}
+      : pool_(workers), sm_(db_file), strip_prefix_(path_strip_prefix),
+        cache_line_size_(64), odr_check_(false), dry_run_(false),
+        shards_(1), memory_warn_(1024 * kMiB) {}
+
+  void setCacheLineSize(uint64_t line_size) { cache_line_size_ = line_size; }
+  void setODRCheck(bool enable) { odr_check_ = enable; }
+  void setDryRun(bool enable) { dry_run_ = enable; }
+  void setShards(unsigned long shards) { shards_ = shards; }
+  void setMemoryWarn(uint64_t mib) { memory_warn_ = mib * kMiB; }
+  void setReportFile(fs::path report_file) { report_file_ = report_file; }
+  void setTraceFile(fs::path trace_file) {
+    trace_file_ = trace_file;
+    cheri::Tracer::enable();
+    cheri::Tracer::nameThread("main");
+  }
+  void setTopLayouts(size_t limit, cheri::LayoutMetric metric) {
+    top_ = std::make_shared<cheri::SharedTopLayouts>(limit, metric);
+  }
+  void setProgress(std::chrono::seconds interval,
+                   std::optional<fs::path> status_file) {
+    progress_ = std::make_shared<cheri::ProgressCounters>();
+    pool_.setProgress(progress_);
+    reporter_ = std::make_unique<cheri::ProgressReporter>(
+        progress_, sm_, interval, status_file);
+  }
 
   void addTarget(fs::path target, ScraperID scraper_id) {
+    if (scraper_id == ScraperID::StackFrame) {
+      // Split the compilation units across jobs, each job needs its own
+      // DWARF context.
+      for (unsigned long shard = 0; shard < shards_; shard++) {
+        auto scraper = std::make_unique<cheri::StackFrameScraper>(
+            sm_, std::make_unique<cheri::DwarfSource>(target));
+        scraper->setShard(shard, shards_);
+        schedule(std::move(scraper));
+      }
+      return;
+    }
+
     auto source = std::make_unique<cheri::DwarfSource>(target);
     std::unique_ptr<cheri::DwarfScraper> scraper;
     switch (scraper_id) {
-    case ScraperID::FlatLayout:
-      scraper =
+    case ScraperID::FlatLayout: {
+      auto flat_scraper =
           std::make_unique<cheri::FlatLayoutScraper>(sm_, std::move(source));
+      flat_scraper->setCacheLineSize(cache_line_size_);
+      flat_scraper->setODRCheck(odr_check_);
+      flat_scraper->setTopLayouts(top_);
+      scraper = std::move(flat_scraper);
       break;
+    }
     case ScraperID::GlobalSym:
       scraper =
           std::make_unique<cheri::GlobalSymScraper>(sm_, std::move(source));
@@ -120,36 +290,121 @@ public:
       qCritical() << "Unexpected scraper ID";
       throw std::invalid_argument("Invalid value for scraper_id");
     }
-    scraper->setStripPrefix(strip_prefix_);
-    results_.emplace_back(pool_.schedule(std::move(scraper)));
+    schedule(std::move(scraper));
   }
 
-  void waitComplete() { pool_.wait(); }
+  void waitComplete() {
+    pool_.wait();
+    // Stop the reporter, this prints the final progress
+    reporter_.reset();
+    if (trace_file_) {
+      // The workers are idle, flush the span buffers
+      std::ofstream out(*trace_file_);
+      if (!out) {
+        qCritical() << "Can not open trace file" << *trace_file_;
+        return;
+      }
+      cheri::Tracer::write(out);
+      qInfo() << "Trace written to" << *trace_file_;
+    }
+  }
 
   bool report() {
     int has_error = false;
-    for (auto &fut : results_) {
+    cheri::ScraperResult total;
+    std::vector<cheri::ScraperResult> results;
+    std::vector<cheri::FailedJob> failed_jobs;
+    std::map<std::string, cheri::StorageStats> storage_stats;
+    std::map<std::pair<fs::path, std::string>, cheri::MemoryInfo> job_memory;
+    for (auto &[source, fut] : results_) {
       try {
-        auto result = fut.get();
+        auto &result = results.emplace_back(fut.get());
         qInfo() << result;
+        job_memory[{result.source, result.scraper}].merge(result.memory);
         has_error |= (result.errors.size() != 0);
+        total.merge(result);
+        storage_stats[result.scraper].merge(result.storage);
       } catch (const std::runtime_error &ex) {
-        qCritical() << "Scraper job failed:" << ex.what();
+        qCritical() << "Scraper job for" << source << "failed:" << ex.what();
         has_error = true;
+        failed_jobs.push_back({source, ex.what()});
       }
     }
+    // Merge the shards of a binary before checking the memory, the shards
+    // only count the mapped binary once.
+    for (auto &[job, memory] : job_memory) {
+      if (memory.total() > memory_warn_) {
+        qWarning() << "Scanning" << job.first << "used about"
+                   << memory.total() / kMiB
+                   << "MiB, consider scheduling it separately or with "
+                      "fewer --threads";
+      }
+    }
+    if (top_) {
+      cheri::writeTopReport(std::cout, top_->sorted(), top_->metric());
+    }
+    total.source = "all targets";
+    qInfo() << total;
+    for (auto &[scraper, stats] : storage_stats) {
+      if (stats.transaction.count() == 0)
+        continue;
+      qInfo().noquote() << "Storage for" << QString::fromStdString(scraper)
+                        << "jobs:"
+                        << QString::fromStdString(
+                               cheri::formatStorageStats(stats));
+    }
+    qInfo() << "Peak resident memory:" << cheri::peakResidentBytes() / kMiB
+            << "MiB";
+    if (report_file_) {
+      std::ofstream out(*report_file_);
+      if (!out) {
+        qCritical() << "Can not open report file" << *report_file_;
+        return true;
+      }
+      cheri::writeRunReport(out, results, failed_jobs);
+      qInfo() << "Run report written to" << *report_file_;
+    }
     return has_error;
   }
 
 private:
+  static constexpr uint64_t kMiB = 1024 * 1024;
+
+  void schedule(std::unique_ptr<cheri::DwarfScraper> scraper) {
+    scraper->setStripPrefix(strip_prefix_);
+    scraper->setDryRun(dry_run_);
+    scraper->setProgress(progress_);
+    auto source = scraper->source().getPath();
+    results_.emplace_back(source, pool_.schedule(std::move(scraper)));
+  }
+
   /* Thread pool where work is submitted */
   cheri::ThreadPool pool_;
-  /* Vector of future results */
-  std::vector<std::future<cheri::ScraperResult>> results_;
+  /* Vector of future results, with the binary each job scans */
+  std::vector<std::pair<fs::path, std::future<cheri::ScraperResult>>> results_;
   /* Storage manager */
   cheri::StorageManager sm_;
   /* File path prefix to strip */
   std::optional<std::string> strip_prefix_;
+  /* Cache line size for the flat-layout footprint analysis */
+  uint64_t cache_line_size_;
+  /* Detect conflicting layout definitions */
+  bool odr_check_;
+  /* Skip the database and only collect counters */
+  bool dry_run_;
+  /* Number of jobs per target for the stack-frame scraper */
+  unsigned long shards_;
+  /* Estimated memory per job above which the job is flagged */
+  uint64_t memory_warn_;
+  /* Machine-readable run report, if enabled */
+  std::optional<fs::path> report_file_;
+  /* Chrome trace output, if enabled */
+  std::optional<fs::path> trace_file_;
+  /* Shared heap for the top-N mode, if enabled */
+  std::shared_ptr<cheri::SharedTopLayouts> top_;
+  /* Progress counters and reporter, if enabled */
+  std::shared_ptr<cheri::ProgressCounters> progress_;
+  std::unique_ptr<cheri::ProgressReporter> reporter_;
 };
 
 } // namespace
@@ -184,6 +439,76 @@ int main(int argc, char **argv) {
   threads.setDefaultValue(QString::number(std::thread::hardware_concurrency()));
   parser.addOption(threads);
 
+  QCommandLineOption cache_line_size(
+      "cache-line-size",
+      "Cache line size used by the flat-layout footprint analysis", "BYTES");
+  cache_line_size.setDefaultValue("64");
+  parser.addOption(cache_line_size);
+
+  QCommandLineOption odr("odr",
+                         "Record conflicting definitions of the same layout "
+                         "in the odr_conflict table (flat-layout only)");
+  parser.addOption(odr);
+
+  QCommandLineOption dry_run("dry-run",
+                             "Scan without writing to the database, only "
+                             "print a summary of the scanned data");
+  parser.addOption(dry_run);
+
+  QCommandLineOption shards("shards",
+                            "Split the compilation units of each target "
+                            "across N jobs (stack-frame only, defaults to "
+                            "the number of threads)",
+                            "N");
+  parser.addOption(shards);
+
+  QCommandLineOption progress("progress",
+                              "Report the scan progress and throughput "
+                              "every N seconds",
+                              "N");
+  parser.addOption(progress);
+
+  QCommandLineOption status_file(
+      "status-file",
+      "Write the progress to a status file instead of the log, the file is "
+      "replaced at every report (implies --progress 10 if not given)",
+      "PATH");
+  parser.addOption(status_file);
+
+  QCommandLineOption report("report",
+                            "Write a JSON report with the counters, errors "
+                            "and timings of each target to FILE",
+                            "FILE");
+  parser.addOption(report);
+
+  QCommandLineOption trace_file("trace",
+                                "Write per-thread spans in the Chrome trace "
+                                "event format to FILE, for Perfetto",
+                                "FILE");
+  parser.addOption(trace_file);
+
+  QCommandLineOption memory_warn(
+      "memory-warn",
+      "Warn about targets whose scan is estimated to use more than "
+      "MIB mebibytes of memory",
+      "MIB");
+  memory_warn.setDefaultValue("1024");
+  parser.addOption(memory_warn);
+
+  QCommandLineOption top("top",
+                         "Only report the N worst layouts, ranked by the "
+                         "--by metric, without writing them to the database "
+                         "(flat-layout only)",
+                         "N");
+  parser.addOption(top);
+
+  QCommandLineOption top_by("by",
+                            "Metric for --top, one of 'padding', "
+                            "'imprecise' or 'size' (defaults to padding)",
+                            "METRIC");
+  top_by.setDefaultValue("padding");
+  parser.addOption(top_by);
+
   QCommandLineOption database("database",
                               "Database file to store the information "
                               "(defaults to cheri-dwarf.sqlite)",
@@ -202,9 +527,46 @@ int main(int argc, char **argv) {
   QCommandLineOption read_stdin("read-stdin", "Read input files from stdin");
   parser.addOption(read_stdin);
 
+  QCommandLineOption against("against",
+                             "Database to compare against the --database "
+                             "layouts, for the 'compare' and 'diff' modes",
+                             "PATH");
+  parser.addOption(against);
+
+  QCommandLineOption output("output",
+                            "Symbol ordering file written by the 'place' mode",
+                            "PATH");
+  parser.addOption(output);
+
+  QCommandLineOption binary("binary",
+                            "Binary to use in the 'place' mode, when the "
+                            "database contains more than one",
+                            "PATH");
+  parser.addOption(binary);
+
+  QCommandLineOption size_classes("size-classes",
+                                  "Allocator size class table for the "
+                                  "'heap' mode, one 'SIZE [ALIGN]' per line",
+                                  "PATH");
+  parser.addOption(size_classes);
+
+  QCommandLineOption cap_format("cap-format",
+                                "Capability format for the 'heap' mode, one "
+                                "of 'morello', 'riscv128' or 'riscv64'",
+                                "FORMAT");
+  cap_format.setDefaultValue("riscv128");
+  parser.addOption(cap_format);
+
   parser.addPositionalArgument(
       "scraper",
-      "Select scraper to run. Valid values are 'flat-layout', 'global-sym'");
+      "Select scraper to run. Valid values are 'flat-layout', 'global-sym', "
+      "'stack-frame'. "
+      "Use 'compare' to compare the layout sizes in --database and --against, "
+      "'diff' to show the layouts that changed between them, "
+      "'place' to write a global symbol ordering file to --output, "
+      "'heap' to report the heap size class of each layout, "
+      "'annotate' to resolve 'TYPE OFFSET' records from --input or stdin "
+      "to layout members");
 
   parser.process(app);
 
@@ -234,10 +596,64 @@ int main(int argc, char **argv) {
     parser.showHelp(1);
   }
   auto scraper_name = args.at(0);
+  if (scraper_name == "compare" || scraper_name == "diff") {
+    if (!parser.isSet(against)) {
+      qCritical() << "Missing --against database for" << scraper_name;
+      parser.showHelp(/*exitCode=*/1);
+    }
+    auto base_db = fs::path(parser.value(database).toStdString());
+    auto other_db = fs::path(parser.value(against).toStdString());
+    if (scraper_name == "compare")
+      return runCompare(base_db, other_db);
+    return runDiff(base_db, other_db);
+  }
+  if (scraper_name == "place") {
+    if (!parser.isSet(output)) {
+      qCritical() << "Missing --output ordering file for" << scraper_name;
+      parser.showHelp(/*exitCode=*/1);
+    }
+    std::optional<std::string> opt_binary;
+    if (parser.isSet(binary)) {
+      opt_binary = parser.value(binary).toStdString();
+    }
+    return runPlace(fs::path(parser.value(database).toStdString()), opt_binary,
+                    fs::path(parser.value(output).toStdString()));
+  }
+  if (scraper_name == "annotate") {
+    std::optional<fs::path> trace;
+    if (parser.isSet(input_path)) {
+      trace = parser.value(input_path).toStdString();
+    }
+    return runAnnotate(fs::path(parser.value(database).toStdString()), trace);
+  }
+  if (scraper_name == "heap") {
+    if (!parser.isSet(size_classes)) {
+      qCritical() << "Missing --size-classes table for" << scraper_name;
+      parser.showHelp(/*exitCode=*/1);
+    }
+    auto opt_format =
+        cheri::parseCapFormat(parser.value(cap_format).toStdString());
+    if (!opt_format) {
+      qCritical() << "Invalid value for option --cap-format:"
+                  << parser.value(cap_format);
+      parser.showHelp(/*exitCode=*/1);
+    }
+    bool ok;
+    int opt_workers = parser.value(threads).toInt(&ok);
+    if (!ok || opt_workers < 1) {
+      qCritical() << "Invalid value for option --threads:"
+                  << parser.value(threads);
+      parser.showHelp(/*exitCode=*/1);
+    }
+    return runHeapClasses(fs::path(parser.value(database).toStdString()),
+                          fs::path(parser.value(size_classes).toStdString()),
+                          *opt_format, opt_workers);
+  }
   ScraperID scraper_id = scraperNameToID(scraper_name);
   if (scraper_id == ScraperID::Unset) {
     qCritical() << "Invalid scraper name '" << scraper_name << "'"
-                << "Must be one of {'flat-layout', 'global-sym'}";
+                << "Must be one of {'flat-layout', 'global-sym', "
+                   "'stack-frame'}";
     parser.showHelp(/*exitCode=*/1);
   }
 
@@ -249,8 +665,17 @@ int main(int argc, char **argv) {
     parser.showHelp(/*exitCode=*/1);
   }
 
+  unsigned long long opt_line_size =
+      parser.value(cache_line_size).toULongLong(&ok);
+  if (!ok || !std::has_single_bit(opt_line_size)) {
+    qCritical() << "Invalid value for option --cache-line-size, must be a "
+                   "power of two:"
+                << parser.value(cache_line_size);
+    parser.showHelp(/*exitCode=*/1);
+  }
+
   auto opt_database = fs::path(parser.value(database).toStdString());
-  if (parser.isSet(clean)) {
+  if (parser.isSet(clean) && !parser.isSet(dry_run)) {
     qDebug() << "Wiping database" << opt_database;
     if (fs::exists(opt_database)) {
       fs::remove(opt_database);
@@ -264,6 +689,70 @@ int main(int argc, char **argv) {
 
   qDebug() << "Initialize thread pool with" << opt_workers << "workers";
   Driver ctx(opt_workers, opt_database, opt_prefix);
+  ctx.setCacheLineSize(opt_line_size);
+  ctx.setODRCheck(parser.isSet(odr));
+  ctx.setDryRun(parser.isSet(dry_run));
+  if (parser.isSet(shards)) {
+    unsigned long opt_shards = parser.value(shards).toULong(&ok);
+    if (!ok || opt_shards == 0) {
+      qCritical() << "Invalid value for option --shards, must be a positive "
+                     "integer:"
+                  << parser.value(shards);
+      parser.showHelp(/*exitCode=*/1);
+    }
+    ctx.setShards(opt_shards);
+  } else {
+    ctx.setShards(std::max(opt_workers, 1));
+  }
+  unsigned long long opt_memory_warn =
+      parser.value(memory_warn).toULongLong(&ok);
+  if (!ok) {
+    qCritical() << "Invalid value for option --memory-warn, must be an "
+                   "integer:"
+                << parser.value(memory_warn);
+    parser.showHelp(/*exitCode=*/1);
+  }
+  ctx.setMemoryWarn(opt_memory_warn);
+  if (parser.isSet(report)) {
+    ctx.setReportFile(parser.value(report).toStdString());
+  }
+  if (parser.isSet(trace_file)) {
+    ctx.setTraceFile(parser.value(trace_file).toStdString());
+  }
+  if (parser.isSet(top)) {
+    unsigned long long opt_top = parser.value(top).toULongLong(&ok);
+    if (!ok || opt_top == 0) {
+      qCritical() << "Invalid value for option --top, must be a positive "
+                     "integer:"
+                  << parser.value(top);
+      parser.showHelp(/*exitCode=*/1);
+    }
+    auto opt_metric =
+        cheri::parseLayoutMetric(parser.value(top_by).toStdString());
+    if (!opt_metric) {
+      qCritical() << "Invalid value for option --by:" << parser.value(top_by);
+      parser.showHelp(/*exitCode=*/1);
+    }
+    ctx.setTopLayouts(opt_top, *opt_metric);
+  }
+
+  if (parser.isSet(progress) || parser.isSet(status_file)) {
+    unsigned long opt_interval = 10;
+    if (parser.isSet(progress)) {
+      opt_interval = parser.value(progress).toULong(&ok);
+      if (!ok || opt_interval == 0) {
+        qCritical() << "Invalid value for option --progress, must be a "
+                       "positive integer:"
+                    << parser.value(progress);
+        parser.showHelp(/*exitCode=*/1);
+      }
+    }
+    std::optional<fs::path> opt_status;
+    if (parser.isSet(status_file)) {
+      opt_status = parser.value(status_file).toStdString();
+    }
+    ctx.setProgress(std::chrono::seconds(opt_interval), opt_status);
+  }
 
   if (parser.isSet(read_input)) {
     auto input_list = fs::path(parser.value(read_input).toStdString());
@@ -26,11 +26,19 @@
  */
 
 #include <algorithm>
+#include <bit>
 #include <cassert>
+#include <map>
+#include <numeric>
 
 #include <QVariant>
 
+#include <llvm/ADT/Hashing.h>
+#include <llvm/Support/MD5.h>
+
 #include "flat_layout_scraper.hh"
+#include "top_layouts.hh"
+#include "trace.hh"
 
 namespace fs = std::filesystem;
 namespace dwarf = llvm::dwarf;
@@ -61,6 +69,171 @@ FlattenedLayout::FlattenedLayout(const TypeDesc &desc) : FlattenedLayout() {
     kind = LayoutKind::Union;
 }
 
+ArrayElementPrecision findImpreciseElements(uint64_t offset, uint64_t stride,
+                                            uint64_t count, uint64_t align,
+                                            bool exact_length) {
+  assert(std::has_single_bit(align) && "Alignment must be a power of two");
+  ArrayElementPrecision result;
+
+  if (count == 0)
+    return result;
+
+  if (!exact_length) {
+    result.imprecise = count;
+    result.first_imprecise = 0;
+    return result;
+  }
+
+  /*
+   * Solve offset + i * stride = 0 (mod align).
+   * Let g = gcd(stride, align), there are solutions iff g divides -offset,
+   * in which case i = i0 (mod align / g).
+   */
+  uint64_t mask = align - 1;
+  uint64_t target = (align - (offset & mask)) & mask;
+  uint64_t step = stride & mask;
+  uint64_t gcd = std::gcd(step, align);
+  if (target % gcd != 0) {
+    result.imprecise = count;
+    result.first_imprecise = 0;
+    return result;
+  }
+
+  uint64_t period = align / gcd;
+  // The step is odd here, so it is invertible modulo the period;
+  // Newton iteration doubles the correct low bits at each step.
+  uint64_t odd_step = step / gcd;
+  uint64_t inverse = odd_step;
+  for (int i = 0; i < 6; i++)
+    inverse *= 2 - odd_step * inverse;
+  uint64_t first_precise = ((target / gcd) * inverse) & (period - 1);
+
+  uint64_t precise = 0;
+  if (first_precise < count)
+    precise = (count - 1 - first_precise) / period + 1;
+  result.imprecise = count - precise;
+  if (result.imprecise > 0)
+    result.first_imprecise = (first_precise == 0) ? 1 : 0;
+
+  return result;
+}
+
+namespace {
+
+uint64_t alignUp(uint64_t value, uint64_t align) {
+  return ((value + align - 1) / align) * align;
+}
+
+/*
+ * Depth-first search over the member orderings.
+ * Members with the same (size, align) are interchangeable, so they are
+ * grouped into classes and each level only picks the next member of each
+ * class, which makes a node O(classes). A branch is cut when the
+ * remaining members can not fit in less than the best size found.
+ */
+struct ReorderSearch {
+  struct ItemClass {
+    uint64_t size;
+    uint64_t align;
+    // Items in the class, in declaration order
+    std::vector<size_t> items;
+    // Number of items not placed yet, they are placed in declaration order
+    size_t remaining;
+  };
+
+  const std::vector<ReorderItem> &items;
+  uint64_t align;
+  uint64_t budget;
+  std::vector<ItemClass> classes;
+  std::vector<size_t> current;
+  ReorderResult best;
+
+  ReorderSearch(const std::vector<ReorderItem> &items, uint64_t align,
+                uint64_t budget)
+      : items(items), align(align), budget(budget) {
+    // Classes are ordered by their first item, as the declaration order
+    std::map<std::pair<uint64_t, uint64_t>, size_t> class_index;
+    for (size_t i = 0; i < items.size(); i++) {
+      auto key = std::make_pair(items[i].size, items[i].align);
+      auto [it, inserted] = class_index.emplace(key, classes.size());
+      if (inserted)
+        classes.push_back({items[i].size, items[i].align, {}, 0});
+      classes[it->second].items.push_back(i);
+    }
+    for (auto &item_class : classes)
+      item_class.remaining = item_class.items.size();
+  }
+
+  void search(uint64_t offset, uint64_t remaining) {
+    if (current.size() == items.size()) {
+      uint64_t size = alignUp(offset, align);
+      if (size < best.size) {
+        best.size = size;
+        best.order = current;
+      }
+      return;
+    }
+    if (alignUp(offset + remaining, align) >= best.size)
+      return;
+
+    for (auto &item_class : classes) {
+      if (item_class.remaining == 0)
+        continue;
+      if (budget == 0) {
+        best.optimal = false;
+        return;
+      }
+      budget--;
+
+      auto next = item_class.items.size() - item_class.remaining;
+      item_class.remaining--;
+      current.push_back(item_class.items[next]);
+      search(alignUp(offset, item_class.align) + item_class.size,
+             remaining - item_class.size);
+      current.pop_back();
+      item_class.remaining++;
+    }
+  }
+};
+
+} // namespace
+
+ReorderResult findCompactOrder(const std::vector<ReorderItem> &items,
+                               uint64_t node_budget) {
+  ReorderResult result;
+  uint64_t align = 1;
+  uint64_t total = 0;
+  for (auto &item : items) {
+    assert(item.align > 0 && "Invalid member alignment");
+    align = std::max(align, item.align);
+    total += item.size;
+  }
+
+  // Decreasing alignment never leaves holes when the sizes are multiples
+  // of the alignment, which is the common case, so start from there.
+  result.order.resize(items.size());
+  std::iota(result.order.begin(), result.order.end(), 0);
+  std::stable_sort(result.order.begin(), result.order.end(),
+                   [&items](size_t l, size_t r) {
+                     if (items[l].align != items[r].align)
+                       return items[l].align > items[r].align;
+                     return items[l].size > items[r].size;
+                   });
+  uint64_t offset = 0;
+  for (auto idx : result.order)
+    offset = alignUp(offset, items[idx].align) + items[idx].size;
+  result.size = alignUp(offset, align);
+
+  uint64_t lower_bound = alignUp(total, align);
+  if (result.size == lower_bound)
+    return result;
+
+  ReorderSearch bnb(items, align, node_budget);
+  bnb.best = result;
+  bnb.search(0, total);
+  return bnb.best;
+}
+
 TypeDecl::TypeDecl(const llvm::DWARFDie &die) : type_die(die), line(0) {
   if (die.getTag() == dwarf::DW_TAG_structure_type)
     kind = DeclKind::Struct;
@@ -80,11 +253,7 @@ void FlatLayoutScraper::initSchema() {
    * Initialize tables, this must be wrapped in a transaction to avoid
    * SQLite row locking errors.
    */
-  sm_.query_tx("CREATE TABLE IF NOT EXISTS binary ("
-            "id INTEGER PRIMARY KEY,"
-            // The executable file
-            "file TEXT NOT NULL,"
-            "UNIQUE(file))");
+  initBinarySchema();
 
   sm_.query_tx("CREATE TABLE IF NOT EXISTS type_layout ("
             "id INTEGER PRIMARY KEY,"
@@ -112,9 +281,36 @@ void FlatLayoutScraper::initSchema() {
             // Does the structure contain a VLA
             "has_vla INTEGER DEFAULT 0 NOT NULL"
             " CHECK(has_vla >= 0 AND has_vla <= 1),"
+            // MD5 of the ordered member tuples, in hex form
+            "fingerprint TEXT NOT NULL,"
             "FOREIGN KEY (binary_id) REFERENCES binary (id),"
             "UNIQUE(binary_id, name, file, line, size))");
 
+  // Used to find definitions of a layout in other binaries
+  sm_.query_tx("CREATE INDEX IF NOT EXISTS type_layout_source ON "
+            "type_layout (file, line)");
+
+  sm_.query_tx("CREATE TABLE IF NOT EXISTS odr_conflict ("
+            "id INTEGER PRIMARY KEY,"
+            // Binary containing the conflicting definition
+            "binary_id INTEGER NOT NULL,"
+            // Shared identity of the conflicting definitions
+            "name TEXT NOT NULL,"
+            "file TEXT NOT NULL,"
+            "line INTEGER NOT NULL,"
+            "size INTEGER NOT NULL,"
+            // Compilation unit and DIE offset of the conflicting definition
+            "unit TEXT NOT NULL,"
+            "die_offset INTEGER NOT NULL,"
+            // Binary of the first definition, may be the same binary
+            "other_binary_id INTEGER NOT NULL,"
+            "other_size INTEGER NOT NULL,"
+            // Compilation unit of the first definition, if in the same binary
+            "other_unit TEXT,"
+            "FOREIGN KEY (binary_id) REFERENCES binary (id),"
+            "FOREIGN KEY (other_binary_id) REFERENCES binary (id),"
+            "UNIQUE(binary_id, file, line, unit, die_offset, other_binary_id))");
+
   sm_.query_tx("CREATE TABLE IF NOT EXISTS layout_member ("
             "id INTEGER PRIMARY KEY,"
             // FK for the corresponding type_layout
@@ -128,10 +324,23 @@ void FlatLayoutScraper::initSchema() {
             "bit_offset INTEGER DEFAULT 0 NOT NULL,"
             "alignment INTEGER DEFAULT 0 NOT NULL,"
             "array_items INTEGER,"
+            // Nesting depth, 0 for the direct members of the layout
+            "depth INTEGER DEFAULT 0 NOT NULL,"
             "base TEXT,"
             "top TEXT,"
             "required_precision INTEGER,"
             "max_vla_size TEXT,"
+            // Minimum offset alignment required for exact bounds
+            "required_align INTEGER DEFAULT 0 NOT NULL,"
+            // Padded length required for exact bounds
+            "padded_size INTEGER DEFAULT 0 NOT NULL,"
+            // Growth of the top-level layout size to make this member precise,
+            // NULL if the member is already precise
+            "layout_size_delta INTEGER,"
+            // For members nested in an array of aggregates, the number of
+            // elements where this member is imprecise and the first of them
+            "imprecise_elements INTEGER,"
+            "first_imprecise_element INTEGER,"
             "is_pointer INTEGER DEFAULT 0 NOT NULL"
             " CHECK(is_pointer >= 0 AND is_pointer <= 1),"
             "is_function INTEGER DEFAULT 0 NOT NULL"
@@ -144,6 +353,49 @@ void FlatLayoutScraper::initSchema() {
             " CHECK(is_imprecise >= 0 AND is_imprecise <= 1),"
             "FOREIGN KEY (owner) REFERENCES type_layout (id),"
             "UNIQUE(owner, name, byte_offset, bit_offset))");
+
+  sm_.query_tx("CREATE TABLE IF NOT EXISTS layout_footprint ("
+            // FK for the corresponding type_layout
+            "owner INTEGER PRIMARY KEY,"
+            "cache_line_size INTEGER NOT NULL,"
+            // Pointers, including pointers in arrays and nested members
+            "pointer_count INTEGER DEFAULT 0 NOT NULL,"
+            "pointer_bytes INTEGER DEFAULT 0 NOT NULL,"
+            // Fraction of the layout size used by pointers
+            "pointer_density REAL DEFAULT 0 NOT NULL,"
+            // Bytes added by capabilities with respect to integer addresses
+            "cap_inflation INTEGER DEFAULT 0 NOT NULL,"
+            // Number of cache lines spanned by the layout
+            "cache_lines INTEGER DEFAULT 0 NOT NULL,"
+            // Members that fit in a line but cross a line boundary
+            "straddling_members INTEGER DEFAULT 0 NOT NULL,"
+            // Byte range and cache lines covered by pointer members,
+            // NULL if there are no pointers
+            "hot_span_begin INTEGER,"
+            "hot_span_end INTEGER,"
+            "hot_span_lines INTEGER DEFAULT 0 NOT NULL,"
+            "FOREIGN KEY (owner) REFERENCES type_layout (id))");
+
+  sm_.query_tx("CREATE TABLE IF NOT EXISTS cache_line_straddle ("
+            // FK for the straddling layout_member
+            "member INTEGER PRIMARY KEY,"
+            "first_line INTEGER NOT NULL,"
+            "last_line INTEGER NOT NULL,"
+            "FOREIGN KEY (member) REFERENCES layout_member (id))");
+
+  sm_.query_tx("CREATE TABLE IF NOT EXISTS layout_reorder ("
+            // FK for the layout that can be reordered
+            "owner INTEGER PRIMARY KEY,"
+            // Size in declaration order with precise member bounds
+            "declared_size INTEGER NOT NULL,"
+            // Size in the suggested order with precise member bounds
+            "optimized_size INTEGER NOT NULL,"
+            "saving INTEGER NOT NULL CHECK (saving > 0),"
+            // Whether the search proved the order to be the best one
+            "optimal INTEGER NOT NULL CHECK (optimal >= 0 AND optimal <= 1),"
+            // Comma-separated top-level member names in the suggested order
+            "member_order TEXT NOT NULL,"
+            "FOREIGN KEY (owner) REFERENCES type_layout (id))");
   // clang-format on
 }
 
@@ -164,17 +416,91 @@ void FlatLayoutScraper::beginUnit(llvm::DWARFDie &unit_die) {
   qDebug() << "Enter compilation unit" << current_unit_;
 }
 
+FlatLayoutScraper::~FlatLayoutScraper() = default;
+
+void FlatLayoutScraper::setTopLayouts(std::shared_ptr<SharedTopLayouts> top) {
+  if (top) {
+    top_ = std::make_unique<TopLayouts>(top->limit(), top->metric());
+  } else {
+    top_.reset();
+  }
+  shared_top_ = std::move(top);
+}
+
 void FlatLayoutScraper::endUnit(llvm::DWARFDie &unit_die) {
   qDebug() << "Done compilation unit" << current_unit_;
 
   for (auto i = layouts_.begin(); i != layouts_.end(); i++) {
     std::unique_ptr<FlattenedLayout> layout;
     std::swap(i->second, layout);
-    checkPadding(*layout);
-    recordLayout(std::move(layout));
+    {
+      TimingScope timing(padding_timing_);
+      checkPadding(*layout);
+    }
+    stats_.layouts++;
+    stats_.members += layout->members.size();
+    stats_.imprecise_members +=
+        std::count_if(layout->members.begin(), layout->members.end(),
+                      [](auto &m) { return m->is_imprecise; });
+    stats_.total_padding += layout->total_padding;
+    if (top_) {
+      // Only the padding and member flags are needed for ranking
+      RankedLayout entry;
+      entry.name = layout->name;
+      entry.file = layout->file;
+      entry.line = layout->line;
+      entry.size = layout->size;
+      entry.score = top_->score(*layout);
+      entry.binary = source().getPath().string();
+      top_->push(std::move(entry));
+      continue;
+    }
+    checkPreciseFix(*layout);
+    checkArrayElements(*layout);
+    checkFootprint(*layout);
+    checkReorder(*layout);
+    computeFingerprint(*layout);
+    if (!dry_run_) {
+      recordLayout(std::move(layout));
+    }
   }
 
   layouts_.clear();
+  if (!odr_conflicts_.empty() && !dry_run_) {
+    recordConflicts();
+  }
+  odr_conflicts_.clear();
+}
+
+void FlatLayoutScraper::endRun() {
+  if (top_) {
+    shared_top_->merge(*top_);
+  }
+}
+
+uint64_t FlatLayoutScraper::stateBytes() const {
+  uint64_t bytes =
+      estimateTableBytes(layouts_) + estimateTableBytes(seen_layouts_);
+  for (auto &[id, layout] : layouts_) {
+    bytes += estimateHeapBytes(std::get<0>(id));
+    if (!layout)
+      continue;
+    bytes += sizeof(FlattenedLayout) + estimateHeapBytes(layout->name) +
+             estimateHeapBytes(layout->file) +
+             estimateHeapBytes(layout->fingerprint);
+    bytes += layout->members.capacity() *
+             sizeof(std::shared_ptr<LayoutMember>);
+    for (auto &m : layout->members) {
+      // The members are allocated with make_shared, with a control block
+      bytes += sizeof(LayoutMember) + 2 * sizeof(void *) +
+               estimateHeapBytes(m->name) + estimateHeapBytes(m->type_name);
+    }
+  }
+  for (auto &[id, seen] : seen_layouts_) {
+    bytes += estimateHeapBytes(std::get<0>(id)) + estimateHeapBytes(seen.unit);
+  }
+  bytes += odr_conflicts_.capacity() * sizeof(ODRConflict);
+  return bytes;
 }
 
 /*
@@ -269,6 +595,8 @@ FlatLayoutScraper::visitCommon(const llvm::DWARFDie &die,
     return std::nullopt;
   }
 
+  TimingScope timing(flatten_timing_);
+  TraceScope span("flatten");
   bool is_union = die.getTag() == dwarf::DW_TAG_union_type;
 
   // Fail if we find a specification, this is not supported.
@@ -292,10 +620,15 @@ FlatLayoutScraper::visitCommon(const llvm::DWARFDie &die,
   qDebug() << "Scanning top-level type" << td.name;
 
   auto layout = std::make_unique<FlattenedLayout>(td);
+  layout->die_offset = die.getOffset();
+  if (odr_check_ && checkODR(die, *layout)) {
+    return std::nullopt;
+  }
   if (auto search = layouts_.find(layout->id()); search != layouts_.end()) {
     // We already have the structure, no need to scan it.
     qDebug() << "Structure " << layout->name << " already scanned "
              << layout->file << layout->line;
+    stats_.dup_structs++;
     return std::nullopt;
   }
 
@@ -429,6 +762,8 @@ std::shared_ptr<LayoutMember> FlatLayoutScraper::visitNested(
   m->required_precision =
       source().findRequiredPrecision(m->byte_offset, m->byte_size);
   m->is_imprecise = (m->byte_offset != m->base) || (length != m->byte_size);
+  std::tie(m->required_align, m->padded_size) =
+      source().findRepresentablePadding(m->byte_size);
   m->depth = depth;
 
   qDebug() << "Traversed member"
@@ -439,6 +774,7 @@ std::shared_ptr<LayoutMember> FlatLayoutScraper::visitNested(
   layout->members.push_back(m);
 
   uint64_t alignment = 0;
+  uint64_t natural_align = 0;
   if (member_desc.decl) {
     auto decl = *member_desc.decl;
     bool is_union = (decl.kind == DeclKind::Union);
@@ -454,8 +790,10 @@ std::shared_ptr<LayoutMember> FlatLayoutScraper::visitNested(
             child.getTag() == dwarf::DW_TAG_inheritance) {
           m_child = visitNested(child, layout, prefix, member_index++,
                                 m->byte_offset, depth + 1);
-          if (m_child)
+          if (m_child) {
             alignment = std::max(alignment, m_child->alignment);
+            natural_align = std::max(natural_align, m_child->natural_align);
+          }
           if (is_union)
             checkVLAMember(layout, m_child);
         }
@@ -468,15 +806,77 @@ std::shared_ptr<LayoutMember> FlatLayoutScraper::visitNested(
   // Determine alignment
   auto tag_alignment = getULongAttr(die, dwarf::DW_AT_alignment);
   alignment = std::max(alignment, tag_alignment.value_or(0));
+  natural_align = std::max(natural_align, tag_alignment.value_or(0));
   if (auto count = m->array_items.value_or(0)) {
     assert(m->byte_size % count == 0);
     alignment = m->byte_size / count;
+    // Arrays of scalars are aligned to the element size
+    if (!natural_align)
+      natural_align = alignment;
   }
   m->alignment = alignment ? alignment : m->byte_size;
+  m->natural_align = natural_align ? natural_align : m->byte_size;
 
   return m;
 }
 
+uint64_t FlatLayoutScraper::structuralHash(const llvm::DWARFDie &die) {
+  llvm::hash_code hash = llvm::hash_combine(
+      die.getTag(), getULongAttr(die, dwarf::DW_AT_byte_size).value_or(0));
+
+  for (auto &child : die.children()) {
+    if (child.getTag() != dwarf::DW_TAG_member &&
+        child.getTag() != dwarf::DW_TAG_inheritance) {
+      continue;
+    }
+    std::string type_name;
+    auto type_die = child.getAttributeValueAsReferencedDie(dwarf::DW_AT_type)
+                        .resolveTypeUnitReference();
+    if (type_die) {
+      llvm::raw_string_ostream type_name_stream(type_name);
+      llvm::dumpTypeUnqualifiedName(type_die, type_name_stream);
+    }
+    hash = llvm::hash_combine(
+        hash, getStrAttr(child, dwarf::DW_AT_name).value_or(""), type_name,
+        getULongAttr(child, dwarf::DW_AT_data_member_location).value_or(0),
+        getULongAttr(child, dwarf::DW_AT_data_bit_offset).value_or(0),
+        getULongAttr(child, dwarf::DW_AT_bit_offset).value_or(0),
+        getULongAttr(child, dwarf::DW_AT_bit_size).value_or(0));
+  }
+  return hash;
+}
+
+bool FlatLayoutScraper::checkODR(const llvm::DWARFDie &die,
+                                 const FlattenedLayout &layout) {
+  uint64_t hash = structuralHash(die);
+
+  auto [pos, inserted] = seen_layouts_.emplace(
+      layout.id(), SeenLayout{hash, layout.size, current_unit_});
+  if (inserted) {
+    return false;
+  }
+  if (pos->second.hash == hash) {
+    stats_.dup_structs++;
+    return true;
+  }
+  qWarning() << "ODR conflict for" << layout.name << "at"
+             << std::format("{}:{} in {} and {}", layout.file, layout.line,
+                            pos->second.unit, current_unit_);
+  ODRConflict conflict;
+  conflict.name = layout.name;
+  conflict.file = layout.file;
+  conflict.line = layout.line;
+  conflict.size = layout.size;
+  conflict.unit = current_unit_;
+  conflict.die_offset = die.getOffset();
+  conflict.other_size = pos->second.size;
+  conflict.other_unit = pos->second.unit;
+  odr_conflicts_.emplace_back(std::move(conflict));
+  // Only the first definition is recorded, the type_layout identity can
+  // not tell the two apart and the members would be mixed.
+  return true;
+}
+
 void FlatLayoutScraper::checkVLAMember(FlattenedLayout *layout,
                                        std::shared_ptr<LayoutMember> member) {
   if (member == nullptr)
@@ -602,24 +1002,300 @@ void FlatLayoutScraper::checkPadding(FlattenedLayout &layout) {
   layout.nested_holes = info.nested_holes;
 }
 
-void FlatLayoutScraper::recordLayout(std::unique_ptr<FlattenedLayout> layout) {
+/*
+ * Estimate the top-level layout growth when an imprecise member is moved
+ * to the next offset aligned to required_align and padded to padded_size.
+ * Any gap between the member and the next member that does not overlap with
+ * it absorbs part of the growth. The layout alignment grows to the member
+ * required alignment, as the member bounds depend on the absolute address.
+ */
+void FlatLayoutScraper::checkPreciseFix(FlattenedLayout &layout) {
+  uint64_t layout_align = 1;
+  for (auto &m : layout.members) {
+    if (m->depth == 0)
+      layout_align = std::max(layout_align, m->alignment);
+  }
+
+  for (size_t idx = 0; idx < layout.members.size(); idx++) {
+    auto &m = layout.members[idx];
+    if (!m->is_imprecise)
+      continue;
+
+    uint64_t end = m->byte_offset + m->byte_size;
+    uint64_t next_offset = layout.size;
+    for (size_t next = idx + 1; next < layout.members.size(); next++) {
+      auto &n = layout.members[next];
+      if (n->depth <= m->depth && n->byte_offset >= end) {
+        next_offset = n->byte_offset;
+        break;
+      }
+    }
+    uint64_t slack = (next_offset > end) ? next_offset - end : 0;
+
+    uint64_t align = m->required_align;
+    uint64_t fixed_offset = (m->byte_offset + align - 1) & ~(align - 1);
+    uint64_t growth = (fixed_offset - m->byte_offset) +
+                      (m->padded_size - m->byte_size);
+    growth = (growth > slack) ? growth - slack : 0;
+
+    uint64_t fixed_align = std::max(layout_align, align);
+    uint64_t fixed_size =
+        (layout.size + growth + fixed_align - 1) & ~(fixed_align - 1);
+    m->layout_size_delta = fixed_size - layout.size;
+
+    qDebug() << "Precise fix for"
+             << std::format("{} align {:#x} padded size {:#x} delta {:#x}",
+                            m->name, m->required_align, m->padded_size,
+                            *m->layout_size_delta);
+  }
+}
+
+/*
+ * Members are flattened in depth-first order, so we keep the chain of
+ * parents of the current member and pick the closest array parent.
+ * Note that only the closest enclosing array is considered, elements of
+ * outer arrays are assumed to be aligned like the first one.
+ */
+void FlatLayoutScraper::checkArrayElements(FlattenedLayout &layout) {
+  std::vector<LayoutMember *> parents;
+
+  for (auto &m : layout.members) {
+    parents.resize(m->depth);
+    parents.push_back(m.get());
+
+    LayoutMember *array_parent = nullptr;
+    for (auto it = parents.rbegin() + 1; it != parents.rend(); ++it) {
+      if ((*it)->array_items.value_or(0) > 1) {
+        array_parent = *it;
+        break;
+      }
+    }
+    if (array_parent == nullptr)
+      continue;
+
+    uint64_t count = *array_parent->array_items;
+    uint64_t stride = array_parent->byte_size / count;
+    auto summary =
+        findImpreciseElements(m->byte_offset, stride, count, m->required_align,
+                              m->padded_size == m->byte_size);
+    m->imprecise_elements = summary.imprecise;
+    m->first_imprecise_element = summary.first_imprecise;
+    if (summary.imprecise) {
+      qDebug() << "Array element imprecision"
+               << std::format("{} imprecise in {}/{} elements, first {}",
+                              m->name, summary.imprecise, count,
+                              *summary.first_imprecise);
+    }
+  }
+}
+
+/*
+ * Cache line indexes assume that the layout is allocated at the start of
+ * a cache line.
+ * Pointers in nested arrays of aggregates are only flattened for the first
+ * element, so we scale them by the number of elements of the parents.
+ */
+void FlatLayoutScraper::checkFootprint(FlattenedLayout &layout) {
+  const uint64_t line_size = cache_line_size_;
+  const uint64_t addr_size = source().getABIAddressSize();
+  std::vector<unsigned long long> multipliers;
+
+  for (auto &m : layout.members) {
+    multipliers.resize(m->depth);
+    unsigned long long parent_mult =
+        multipliers.empty() ? 1 : multipliers.back();
+    multipliers.push_back(parent_mult *
+                          std::max(m->array_items.value_or(1), 1ULL));
+
+    if (m->is_pointer) {
+      unsigned long long count = parent_mult * m->array_items.value_or(1);
+      unsigned long long item_size =
+          m->array_items.value_or(0) ? m->byte_size / *m->array_items
+                                     : m->byte_size;
+      layout.pointer_count += count;
+      layout.pointer_bytes += count * item_size;
+      if (item_size > addr_size)
+        layout.cap_inflation += count * (item_size - addr_size);
+
+      unsigned long long end = m->byte_offset + m->byte_size;
+      if (layout.hot_span) {
+        layout.hot_span->first =
+            std::min(layout.hot_span->first, m->byte_offset);
+        layout.hot_span->second = std::max(layout.hot_span->second, end);
+      } else {
+        layout.hot_span = std::make_pair(m->byte_offset, end);
+      }
+    }
+
+    if (m->byte_size > 0 && m->byte_size <= line_size) {
+      uint64_t first_line = m->byte_offset / line_size;
+      uint64_t last_line = (m->byte_offset + m->byte_size - 1) / line_size;
+      if (first_line != last_line) {
+        m->straddles_line = true;
+        layout.straddling_members++;
+      }
+    }
+  }
+
+  layout.cache_lines = (layout.size + line_size - 1) / line_size;
+  if (layout.hot_span) {
+    auto [begin, end] = *layout.hot_span;
+    layout.hot_span_lines = (end - 1) / line_size - begin / line_size + 1;
+  }
+
+  qDebug() << "Footprint for"
+           << std::format("{} pointers {} ({:#x} bytes, inflation {:#x}) "
+                          "lines {} straddling {} hot lines {}",
+                          layout.name, layout.pointer_count,
+                          layout.pointer_bytes, layout.cap_inflation,
+                          layout.cache_lines, layout.straddling_members,
+                          layout.hot_span_lines);
+}
+
+/*
+ * Only the top-level members are moved, nested members keep their offset
+ * relative to the parent. Each member is placed with the alignment and
+ * padded size that make its bounds precise, so the declaration order is
+ * measured with the same constraints to obtain a fair saving.
+ * Unions, layouts with VLAs or bitfields and packed layouts are skipped.
+ */
+void FlatLayoutScraper::checkReorder(FlattenedLayout &layout) {
+  if (layout.kind != LayoutKind::Struct || layout.has_vla)
+    return;
+
+  std::vector<LayoutMember *> top_level;
+  std::vector<ReorderItem> items;
+  uint64_t layout_align = 1;
+  uint64_t declared_end = 0;
+  for (auto &m : layout.members) {
+    if (m->depth != 0)
+      continue;
+    if (m->bit_size != 0 || m->bit_offset != 0)
+      return;
+    if (m->natural_align == 0 || m->byte_offset % m->natural_align != 0)
+      return;
+
+    ReorderItem item;
+    item.size = std::max<uint64_t>(m->byte_size, m->padded_size);
+    item.align =
+        std::lcm(m->natural_align, std::max<uint64_t>(m->required_align, 1));
+    declared_end = alignUp(declared_end, item.align) + item.size;
+    layout_align = std::max(layout_align, item.align);
+    top_level.push_back(m.get());
+    items.push_back(item);
+  }
+  if (items.size() < 2)
+    return;
+
+  uint64_t declared_size = alignUp(declared_end, layout_align);
+  auto best = findCompactOrder(items, /*node_budget=*/1 << 16);
+  if (best.size >= declared_size)
+    return;
+
+  LayoutReorder reorder;
+  reorder.declared_size = declared_size;
+  reorder.size = best.size;
+  reorder.optimal = best.optimal;
+  for (auto idx : best.order)
+    reorder.order.push_back(top_level[idx]->name);
+
+  qDebug() << "Reorder" << layout.name
+           << std::format("{:#x} -> {:#x}{}", reorder.declared_size,
+                          reorder.size, reorder.optimal ? "" : " (heuristic)");
+  layout.reorder = std::move(reorder);
+}
+
+/*
+ * The fingerprint covers the layout size and kind and, for each member in
+ * flattening order, the tuple of fields stored in layout_member that depend
+ * on the layout definition. Sizes and offsets are included, so the same
+ * definition compiled for a different ABI has a different fingerprint.
+ */
+void FlatLayoutScraper::computeFingerprint(FlattenedLayout &layout) {
+  llvm::MD5 hash;
+  auto update_str = [&hash](const std::string &value) {
+    hash.update(value);
+    // Separator to avoid ambiguity between adjacent strings
+    hash.update(llvm::StringRef("\0", 1));
+  };
+  auto update_int = [&hash](uint64_t value) {
+    uint8_t bytes[sizeof(value)];
+    for (size_t i = 0; i < sizeof(value); i++)
+      bytes[i] = (value >> (i * 8)) & 0xff;
+    hash.update(bytes);
+  };
+
+  update_int(layout.size);
+  update_int(static_cast<uint64_t>(layout.kind));
+  for (auto &m : layout.members) {
+    update_str(m->name);
+    update_str(m->type_name);
+    update_int(m->byte_offset);
+    update_int(m->bit_offset);
+    update_int(m->byte_size);
+    update_int(m->bit_size);
+    update_int(m->array_items ? *m->array_items + 1 : 0);
+    update_int(m->depth);
+    update_int(m->is_pointer | (m->is_function << 1) | (m->is_union << 2));
+  }
+
+  llvm::MD5::MD5Result result;
+  hash.final(result);
+  layout.fingerprint = result.digest().str().str();
+}
+
+void FlatLayoutScraper::recordConflicts() {
   sm_.transaction([&](StorageManager &sm) {
-    qDebug() << "Transaction for" << layout->name;
+    QVariant binary_id = recordBinary(sm);
 
     // clang-format off
-    auto insert_binary = sm.prepare(
-        "INSERT INTO binary (file) VALUES (:file)"
-        "ON CONFLICT DO NOTHING RETURNING id");
+    auto insert_conflict = sm.prepare(
+        "INSERT INTO odr_conflict (binary_id, name, file, line, size, unit, "
+        "die_offset, other_binary_id, other_size, other_unit) "
+        "VALUES (:binary_id, :name, :file, :line, :size, :unit, "
+        ":die_offset, :other_binary_id, :other_size, :other_unit) "
+        "ON CONFLICT DO NOTHING");
+    // clang-format on
+
+    for (auto &conflict : odr_conflicts_) {
+      insert_conflict.bindValue(":binary_id", binary_id);
+      insert_conflict.bindValue(":name", QString::fromStdString(conflict.name));
+      insert_conflict.bindValue(":file", QString::fromStdString(conflict.file));
+      insert_conflict.bindValue(":line", conflict.line);
+      insert_conflict.bindValue(":size", conflict.size);
+      insert_conflict.bindValue(":unit", QString::fromStdString(conflict.unit));
+      insert_conflict.bindValue(":die_offset",
+                                (unsigned long long)conflict.die_offset);
+      insert_conflict.bindValue(":other_binary_id", binary_id);
+      insert_conflict.bindValue(":other_size", conflict.other_size);
+      insert_conflict.bindValue(":other_unit",
+                                QString::fromStdString(conflict.other_unit));
+      if (!sm.exec(insert_conflict)) {
+        qCritical() << "Failed to insert ODR conflict:"
+                    << insert_conflict.lastQuery();
+        throw DBError(insert_conflict.lastError());
+      }
+      insert_conflict.finish();
+    }
+  });
+}
 
-    auto fetch_binary = sm.prepare(
-        "SELECT id FROM binary WHERE "
-        "file = :file");
+void FlatLayoutScraper::recordLayout(std::unique_ptr<FlattenedLayout> layout) {
+  // Rows that already exist in the database, only counted if the
+  // transaction commits.
+  unsigned long dup_structs = 0;
+  unsigned long dup_members = 0;
+  sm_.transaction([&](StorageManager &sm) {
+    qDebug() << "Transaction for" << layout->name;
 
+    // clang-format off
     auto insert_layout = sm.prepare(
         "INSERT INTO type_layout (binary_id, name, file, line, size, is_union, "
-        "has_vla, total_padding, tail_padding, holes, nested_padding, nested_holes, has_extra_padding) "
+        "has_vla, total_padding, tail_padding, holes, nested_padding, nested_holes, has_extra_padding, "
+        "fingerprint) "
         "VALUES (:binary_id, :name, :file, :line, :size, :is_union, "
-        ":has_vla, :total_padding, :tail_padding, :holes, :nested_padding, :nested_holes, :has_extra_padding) "
+        ":has_vla, :total_padding, :tail_padding, :holes, :nested_padding, :nested_holes, :has_extra_padding, "
+        ":fingerprint) "
         "ON CONFLICT DO NOTHING RETURNING id");
 
     auto fetch_layout = sm.prepare(
@@ -629,41 +1305,44 @@ void FlatLayoutScraper::recordLayout(std::unique_ptr<FlattenedLayout> layout) {
     auto insert_member = sm.prepare(
         "INSERT INTO layout_member ("
         "owner, name, type_name, byte_offset, bit_offset, "
-        "byte_size, bit_size, array_items, alignment, "
+        "byte_size, bit_size, array_items, depth, alignment, "
         "base, top, required_precision, max_vla_size, "
+        "required_align, padded_size, layout_size_delta, "
+        "imprecise_elements, first_imprecise_element, "
         "is_pointer, is_function, is_anon, is_union, is_imprecise"
         ") VALUES ("
         ":owner, :name, :type_name, :byte_offset, :bit_offset, "
-        ":byte_size, :bit_size, :array_items, :alignment, "
+        ":byte_size, :bit_size, :array_items, :depth, :alignment, "
         ":base, :top, :required_precision, :max_vla_size, "
+        ":required_align, :padded_size, :layout_size_delta, "
+        ":imprecise_elements, :first_imprecise_element, "
         ":is_pointer, :is_function, :is_anon, :is_union, :is_imprecise"
         ") ON CONFLICT DO NOTHING RETURNING id");
+
+    auto insert_footprint = sm.prepare(
+        "INSERT INTO layout_footprint ("
+        "owner, cache_line_size, pointer_count, pointer_bytes, "
+        "pointer_density, cap_inflation, cache_lines, straddling_members, "
+        "hot_span_begin, hot_span_end, hot_span_lines"
+        ") VALUES ("
+        ":owner, :cache_line_size, :pointer_count, :pointer_bytes, "
+        ":pointer_density, :cap_inflation, :cache_lines, :straddling_members, "
+        ":hot_span_begin, :hot_span_end, :hot_span_lines"
+        ") ON CONFLICT DO NOTHING");
+
+    auto insert_straddle = sm.prepare(
+        "INSERT INTO cache_line_straddle (member, first_line, last_line) "
+        "VALUES (:member, :first_line, :last_line) ON CONFLICT DO NOTHING");
+
+    auto insert_reorder = sm.prepare(
+        "INSERT INTO layout_reorder ("
+        "owner, declared_size, optimized_size, saving, optimal, member_order"
+        ") VALUES ("
+        ":owner, :declared_size, :optimized_size, :saving, :optimal, :member_order"
+        ") ON CONFLICT DO NOTHING");
     // clang-format on
 
-    insert_binary.bindValue(":file", QString::fromStdString(source().getPath().string()));
-    if (!insert_binary.exec()) {
-      // Failed, abort the transaction
-      qCritical() << "Failed to insert binary:" << insert_binary.lastQuery();
-      throw DBError(insert_binary.lastError());
-    }
-    QVariant binary_id;
-    if (!insert_binary.first()) {
-      fetch_binary.bindValue(":file", QString::fromStdString(source().getPath().string()));
-      if (!fetch_binary.exec()) {
-        qCritical() << "Failed to fetch binary ID:"
-                    << fetch_binary.lastQuery();
-        throw DBError(fetch_binary.lastError());
-      }
-      if (!fetch_binary.first()) {
-        qCritical() << "Binary record colud not be found";
-        throw ScraperError("Unexpected missing binary");
-      }
-      binary_id = fetch_binary.value(0);
-      fetch_binary.finish();
-    } else {
-      binary_id = insert_binary.value(0);
-    }
-    insert_binary.finish();
+    QVariant binary_id = recordBinary(sm);
 
     insert_layout.bindValue(":binary_id", binary_id);
     insert_layout.bindValue(":name", QString::fromStdString(layout->name));
@@ -682,19 +1361,22 @@ void FlatLayoutScraper::recordLayout(std::unique_ptr<FlattenedLayout> layout) {
     insert_layout.bindValue(":nested_padding", layout->nested_padding);
     insert_layout.bindValue(":nested_holes", layout->nested_holes);
     insert_layout.bindValue(":has_extra_padding", layout->has_extra_padding);
-    if (!insert_layout.exec()) {
+    insert_layout.bindValue(":fingerprint",
+                            QString::fromStdString(layout->fingerprint));
+    if (!sm.exec(insert_layout)) {
       // Failed, abort the transaction
       qCritical() << "Failed to insert layout:" << insert_layout.lastQuery();
       throw DBError(insert_layout.lastError());
     }
     QVariant layout_id;
     if (!insert_layout.first()) {
+      dup_structs++;
       fetch_layout.bindValue(":binary_id", binary_id);
       fetch_layout.bindValue(":name", QString::fromStdString(layout->name));
       fetch_layout.bindValue(":file", QString::fromStdString(layout->file));
       fetch_layout.bindValue(":line", layout->line);
       fetch_layout.bindValue(":size", layout->size);
-      if (!fetch_layout.exec()) {
+      if (!sm.exec(fetch_layout)) {
         qCritical() << "Failed to fetch layout ID:"
                     << insert_layout.lastQuery();
         throw DBError(insert_layout.lastError());
@@ -710,6 +1392,103 @@ void FlatLayoutScraper::recordLayout(std::unique_ptr<FlattenedLayout> layout) {
     }
     insert_layout.finish();
 
+    if (odr_check_) {
+      // Definitions of the same layout in other binaries must match.
+      // The fingerprint depends on the ABI, so only binaries built for
+      // the same ABI are compared.
+      // clang-format off
+      auto insert_conflict = sm.prepare(
+          "INSERT INTO odr_conflict (binary_id, name, file, line, size, unit, "
+          "die_offset, other_binary_id, other_size, other_unit) "
+          "SELECT :binary_id, :name, :file, :line, :size, :unit, "
+          ":die_offset, other.binary_id, other.size, NULL "
+          "FROM type_layout AS other "
+          "JOIN binary AS self ON self.id = :match_binary_id "
+          "JOIN binary AS other_bin ON other_bin.id = other.binary_id WHERE "
+          "other.file = :match_file AND other.line = :match_line AND "
+          "other.name = :match_name AND other.binary_id != :match_binary_id AND "
+          "other_bin.pointer_size = self.pointer_size AND "
+          "other_bin.cap_size = self.cap_size AND "
+          "other.fingerprint != :fingerprint "
+          "ON CONFLICT DO NOTHING");
+      // clang-format on
+      insert_conflict.bindValue(":binary_id", binary_id);
+      insert_conflict.bindValue(":name", QString::fromStdString(layout->name));
+      insert_conflict.bindValue(":file", QString::fromStdString(layout->file));
+      insert_conflict.bindValue(":line", layout->line);
+      insert_conflict.bindValue(":size", layout->size);
+      insert_conflict.bindValue(":unit", QString::fromStdString(current_unit_));
+      insert_conflict.bindValue(":die_offset",
+                                (unsigned long long)layout->die_offset);
+      insert_conflict.bindValue(":match_binary_id", binary_id);
+      insert_conflict.bindValue(":match_name",
+                                QString::fromStdString(layout->name));
+      insert_conflict.bindValue(":match_file",
+                                QString::fromStdString(layout->file));
+      insert_conflict.bindValue(":match_line", layout->line);
+      insert_conflict.bindValue(":fingerprint",
+                                QString::fromStdString(layout->fingerprint));
+      if (!sm.exec(insert_conflict)) {
+        qCritical() << "Failed to check ODR conflicts:"
+                    << insert_conflict.lastQuery();
+        throw DBError(insert_conflict.lastError());
+      }
+      insert_conflict.finish();
+    }
+
+    insert_footprint.bindValue(":owner", layout_id);
+    insert_footprint.bindValue(":cache_line_size",
+                               (unsigned long long)cache_line_size_);
+    insert_footprint.bindValue(":pointer_count", layout->pointer_count);
+    insert_footprint.bindValue(":pointer_bytes", layout->pointer_bytes);
+    insert_footprint.bindValue(
+        ":pointer_density",
+        layout->size ? static_cast<double>(layout->pointer_bytes) / layout->size
+                     : 0.0);
+    insert_footprint.bindValue(":cap_inflation", layout->cap_inflation);
+    insert_footprint.bindValue(":cache_lines", layout->cache_lines);
+    insert_footprint.bindValue(":straddling_members",
+                               layout->straddling_members);
+    if (layout->hot_span) {
+      insert_footprint.bindValue(":hot_span_begin", layout->hot_span->first);
+      insert_footprint.bindValue(":hot_span_end", layout->hot_span->second);
+    } else {
+      insert_footprint.bindValue(":hot_span_begin",
+                                 QVariant::fromValue(nullptr));
+      insert_footprint.bindValue(":hot_span_end",
+                                 QVariant::fromValue(nullptr));
+    }
+    insert_footprint.bindValue(":hot_span_lines", layout->hot_span_lines);
+    if (!sm.exec(insert_footprint)) {
+      qCritical() << "Failed to insert layout footprint:"
+                  << insert_footprint.lastQuery();
+      throw DBError(insert_footprint.lastError());
+    }
+    insert_footprint.finish();
+
+    if (layout->reorder) {
+      auto &reorder = *layout->reorder;
+      std::string member_order;
+      for (auto &name : reorder.order) {
+        if (!member_order.empty())
+          member_order += ",";
+        member_order += name;
+      }
+      insert_reorder.bindValue(":owner", layout_id);
+      insert_reorder.bindValue(":declared_size", reorder.declared_size);
+      insert_reorder.bindValue(":optimized_size", reorder.size);
+      insert_reorder.bindValue(":saving", reorder.declared_size - reorder.size);
+      insert_reorder.bindValue(":optimal", reorder.optimal);
+      insert_reorder.bindValue(":member_order",
+                               QString::fromStdString(member_order));
+      if (!sm.exec(insert_reorder)) {
+        qCritical() << "Failed to insert layout reorder:"
+                    << insert_reorder.lastQuery();
+        throw DBError(insert_reorder.lastError());
+      }
+      insert_reorder.finish();
+    }
+
     for (auto &m : layout->members) {
       insert_member.bindValue(":owner", layout_id);
       insert_member.bindValue(":name", QString::fromStdString(m->name));
@@ -724,6 +1503,7 @@ void FlatLayoutScraper::recordLayout(std::unique_ptr<FlattenedLayout> layout) {
       } else {
         insert_member.bindValue(":array_items", QVariant::fromValue(nullptr));
       }
+      insert_member.bindValue(":depth", (unsigned long long)m->depth);
       insert_member.bindValue(":alignment", (unsigned long long)m->alignment);
       insert_member.bindValue(":base", QString::fromStdString(std::to_string(m->base)));
       insert_member.bindValue(":top",  QString::fromStdString(std::to_string(m->top)));
@@ -735,22 +1515,68 @@ void FlatLayoutScraper::recordLayout(std::unique_ptr<FlattenedLayout> layout) {
       } else {
         insert_member.bindValue(":max_vla_size", QVariant::fromValue(nullptr));
       }
+      insert_member.bindValue(":required_align",
+                              (unsigned long long)m->required_align);
+      insert_member.bindValue(":padded_size", m->padded_size);
+      if (m->layout_size_delta) {
+        insert_member.bindValue(":layout_size_delta", *m->layout_size_delta);
+      } else {
+        insert_member.bindValue(":layout_size_delta",
+                                QVariant::fromValue(nullptr));
+      }
+      if (m->imprecise_elements) {
+        insert_member.bindValue(":imprecise_elements", *m->imprecise_elements);
+      } else {
+        insert_member.bindValue(":imprecise_elements",
+                                QVariant::fromValue(nullptr));
+      }
+      if (m->first_imprecise_element) {
+        insert_member.bindValue(":first_imprecise_element",
+                                *m->first_imprecise_element);
+      } else {
+        insert_member.bindValue(":first_imprecise_element",
+                                QVariant::fromValue(nullptr));
+      }
       insert_member.bindValue(":is_pointer", m->is_pointer);
       insert_member.bindValue(":is_function", m->is_function);
       insert_member.bindValue(":is_anon", m->is_anon);
       insert_member.bindValue(":is_union", m->is_union);
       insert_member.bindValue(":is_imprecise", m->is_imprecise);
-      if (!insert_member.exec()) {
+      if (!sm.exec(insert_member)) {
         // Failed, abort the transaction
         qCritical() << "Failed to insert layout member:"
                     << insert_member.lastQuery();
         throw DBError(insert_member.lastError());
       }
+      bool member_inserted = insert_member.first();
+      if (!member_inserted) {
+        dup_members++;
+      }
+      if (m->straddles_line && member_inserted) {
+        insert_straddle.bindValue(":member", insert_member.value(0));
+        insert_straddle.bindValue(
+            ":first_line",
+            (unsigned long long)(m->byte_offset / cache_line_size_));
+        insert_straddle.bindValue(
+            ":last_line", (unsigned long long)((m->byte_offset + m->byte_size -
+                                                1) / cache_line_size_));
+        if (!sm.exec(insert_straddle)) {
+          qCritical() << "Failed to insert cache line straddle:"
+                      << insert_straddle.lastQuery();
+          throw DBError(insert_straddle.lastError());
+        }
+        insert_straddle.finish();
+      }
       insert_member.finish();
     }
 
     qDebug() << "Transaction for" << layout->name << "Done";
   });
+  stats_.dup_structs += dup_structs;
+  stats_.dup_members += dup_members;
+  if (progress_) {
+    progress_->layouts.fetch_add(1, std::memory_order_relaxed);
+  }
 }
 
 } /* namespace cheri */
@@ -27,6 +27,8 @@
 
 #pragma once
 
+#include <bit>
+#include <cassert>
 #include <cstdint>
 #include <unordered_map>
 
@@ -34,6 +36,9 @@
 
 namespace cheri {
 
+class TopLayouts;
+class SharedTopLayouts;
+
 enum class LayoutKind {
   Struct = 1,
   Class = 2,
@@ -45,9 +50,10 @@ enum class LayoutKind {
  */
 struct LayoutMember {
   LayoutMember()
-      : byte_size(0), bit_size(0), byte_offset(0), bit_offset(0), alignment(0), depth(0),
+      : byte_size(0), bit_size(0), byte_offset(0), bit_offset(0), alignment(0), natural_align(0), depth(0),
         is_pointer(false), is_function(false), is_anon(false), is_union(false),
-        is_imprecise(false), base(0), top(0), required_precision(0) {}
+        is_imprecise(false), straddles_line(false), base(0), top(0), required_precision(0),
+        required_align(0), padded_size(0) {}
 
   // Qualified flattened member name using :: as separator
   std::string name;
@@ -67,6 +73,10 @@ struct LayoutMember {
   std::optional<unsigned long long> array_items;
   // Alignment in bytes
   uint64_t alignment;
+  // Alignment of the member type in bytes, for arrays of aggregates this
+  // is the alignment of the element members instead of the element size.
+  // This is only used by the reordering search.
+  uint64_t natural_align;
   // Depth of member
   uint64_t depth;
   // Flags used to mark member properties
@@ -75,6 +85,8 @@ struct LayoutMember {
   bool is_anon : 1;
   bool is_union : 1;
   bool is_imprecise : 1;
+  // Member crosses a cache line boundary, but would fit in a single line
+  bool straddles_line : 1;
   // Capability base for this sub-object
   uint64_t base;
   // Capability top for this sub-object
@@ -83,6 +95,90 @@ struct LayoutMember {
   short required_precision;
   // If this member is a VLA, the maximum size given the current alignment.
   std::optional<unsigned long long> max_vla_size;
+  // Minimum offset alignment required for exact bounds
+  uint64_t required_align;
+  // Padded length required for exact bounds
+  unsigned long long padded_size;
+  // If this member is imprecise, the growth of the top-level layout size
+  // when the member is aligned to required_align and padded to padded_size.
+  std::optional<unsigned long long> layout_size_delta;
+  // If this member is nested in an array of aggregates, the number of
+  // array elements for which this member is imprecise.
+  std::optional<unsigned long long> imprecise_elements;
+  // Index of the first array element for which this member is imprecise.
+  std::optional<unsigned long long> first_imprecise_element;
+};
+
+/**
+ * Summary of the precision of a member across the elements of an
+ * enclosing array.
+ */
+struct ArrayElementPrecision {
+  ArrayElementPrecision() : imprecise(0) {}
+
+  // Number of elements for which the member is imprecise
+  unsigned long long imprecise;
+  // First element for which the member is imprecise
+  std::optional<unsigned long long> first_imprecise;
+};
+
+/**
+ * Find the array elements for which a member is imprecise.
+ * The member of element i is at offset + i * stride. When the member length
+ * is exactly representable, the member is precise iff its offset is a
+ * multiple of align. Since align is a power of two, the offsets modulo align
+ * repeat with period align / gcd(stride, align), so the precise elements are
+ * the solutions of a linear congruence and can be counted in closed form.
+ */
+ArrayElementPrecision findImpreciseElements(uint64_t offset, uint64_t stride,
+                                            uint64_t count, uint64_t align,
+                                            bool exact_length);
+
+/**
+ * Placement constraints of a member for the reordering search.
+ */
+struct ReorderItem {
+  uint64_t size;
+  uint64_t align;
+};
+
+/**
+ * Best member ordering found by findCompactOrder().
+ */
+struct ReorderResult {
+  ReorderResult() : size(0), optimal(true) {}
+
+  // Indices of the items in placement order
+  std::vector<size_t> order;
+  // Layout size with this order, including tail padding
+  unsigned long long size;
+  // Whether the search completed within the node budget
+  bool optimal;
+};
+
+/**
+ * Find the ordering of a set of members that minimizes the layout size.
+ * Sorting by decreasing alignment is optimal when each size is a multiple
+ * of its alignment; otherwise, a branch-and-bound search refines it, giving
+ * up after node_budget search nodes.
+ */
+ReorderResult findCompactOrder(const std::vector<ReorderItem> &items,
+                               uint64_t node_budget);
+
+/**
+ * Smaller layout found by reordering the top-level members.
+ */
+struct LayoutReorder {
+  LayoutReorder() : declared_size(0), size(0), optimal(false) {}
+
+  // Layout size in declaration order, with precise member bounds
+  unsigned long long declared_size;
+  // Layout size in the suggested order, with precise member bounds
+  unsigned long long size;
+  // Whether the suggested order is known to be the best one
+  bool optimal;
+  // Top-level member names in the suggested order
+  std::vector<std::string> order;
 };
 
 using LayoutId = std::tuple<std::string, size_t>;
@@ -103,7 +199,9 @@ struct FlattenedLayout {
   FlattenedLayout()
       : line(0), size(0), die_offset(0), has_vla(false), total_padding(0),
         tail_padding(0), holes(0), nested_padding(0), nested_holes(0),
-        has_extra_padding(false) {}
+        has_extra_padding(false), pointer_count(0), pointer_bytes(0),
+        cap_inflation(0), cache_lines(0), straddling_members(0),
+        hot_span_lines(0) {}
   FlattenedLayout(const TypeDesc &desc);
   LayoutId id() const { return std::make_tuple(file, line); }
 
@@ -136,6 +234,45 @@ struct FlattenedLayout {
   unsigned long long nested_holes;
   // Is there extra padding on top of alignment requirements
   bool has_extra_padding;
+
+  // Number of pointers, including pointers in arrays and nested members
+  unsigned long long pointer_count;
+  // Bytes used by pointers
+  unsigned long long pointer_bytes;
+  // Bytes added by capabilities with respect to integer addresses
+  unsigned long long cap_inflation;
+  // Number of cache lines spanned by the layout
+  unsigned long long cache_lines;
+  // Number of members that needlessly straddle a cache line boundary
+  unsigned long long straddling_members;
+  // Byte range [begin, end) covering all the pointer members
+  std::optional<std::pair<unsigned long long, unsigned long long>> hot_span;
+  // Number of cache lines touched by the pointer members
+  unsigned long long hot_span_lines;
+
+  // 128-bit hash of the ordered member tuples, as a hex string
+  std::string fingerprint;
+
+  // Member reordering that reduces the layout size, if any
+  std::optional<LayoutReorder> reorder;
+};
+
+/**
+ * Conflicting definitions of a layout with the same (file, line) identity.
+ */
+struct ODRConflict {
+  ODRConflict() : line(0), size(0), die_offset(0), other_size(0) {}
+
+  std::string name;
+  std::string file;
+  unsigned long long line;
+  unsigned long long size;
+  // Compilation unit and DIE of the conflicting definition
+  std::string unit;
+  uint64_t die_offset;
+  // Size and compilation unit of the first definition found
+  unsigned long long other_size;
+  std::string other_unit;
 };
 
 /**
@@ -151,10 +288,33 @@ class FlatLayoutScraper : public DwarfScraper {
 public:
   FlatLayoutScraper(StorageManager &sm,
                     std::unique_ptr<const DwarfSource> dwsrc)
-      : DwarfScraper(sm, std::move(dwsrc)) {}
+      : DwarfScraper(sm, std::move(dwsrc)),
+        flatten_timing_(stats_.phase("flatten")),
+        padding_timing_(stats_.phase("padding")), cache_line_size_(64),
+        odr_check_(false) {}
+  ~FlatLayoutScraper() override;
 
   std::string name() override { return "flat-layout"; }
 
+  /**
+   * Set the cache line size used for the layout footprint analysis.
+   */
+  void setCacheLineSize(uint64_t line_size) {
+    assert(std::has_single_bit(line_size) && "Line size must be a power of 2");
+    cache_line_size_ = line_size;
+  }
+
+  /**
+   * Enable detection of conflicting definitions of the same layout.
+   */
+  void setODRCheck(bool enable) { odr_check_ = enable; }
+
+  /**
+   * Only rank the layouts and keep the top-N in the shared heap, instead of
+   * recording them in the database.
+   */
+  void setTopLayouts(std::shared_ptr<SharedTopLayouts> top);
+
   bool visit_structure_type(llvm::DWARFDie &die);
   bool visit_class_type(llvm::DWARFDie &die);
   bool visit_union_type(llvm::DWARFDie &die);
@@ -173,6 +333,8 @@ protected:
   void initSchema() override;
   void beginUnit(llvm::DWARFDie &unit_die) override;
   void endUnit(llvm::DWARFDie &unit_die) override;
+  void endRun() override;
+  uint64_t stateBytes() const override;
   bool doVisit(llvm::DWARFDie &die) override {
     return impl::visitDispatch(*this, die);
   }
@@ -210,14 +372,74 @@ protected:
    */
   void checkPadding(FlattenedLayout &layout);
 
+  /**
+   * Compare the structural hash of a layout definition with the first
+   * definition found with the same identity in this binary.
+   * Returns true if the layout was already seen, in which case it should not
+   * be flattened again. Conflicting definitions are queued for recording in
+   * the odr_conflict table and are not flattened either.
+   */
+  bool checkODR(const llvm::DWARFDie &die, const FlattenedLayout &layout);
+
+  /**
+   * Compute a shallow structural hash of an aggregate DIE.
+   * This only considers the direct members, so that it is cheap to compute
+   * on the deduplication path.
+   */
+  uint64_t structuralHash(const llvm::DWARFDie &die);
+
+  /**
+   * Insert the queued ODR conflicts into the database.
+   */
+  void recordConflicts();
+
   PaddingInfo checkNestedPadding(const FlattenedLayout &layout, size_t &idx,
                                  const std::shared_ptr<LayoutMember> parent);
 
+  /**
+   * Compute the layout size growth required to fix each imprecise member.
+   * This must run after the layout has been flattened.
+   */
+  void checkPreciseFix(FlattenedLayout &layout);
+
+  /**
+   * Compute the precision of members nested in arrays of aggregates for
+   * all the array elements, not only the first one that is flattened.
+   */
+  void checkArrayElements(FlattenedLayout &layout);
+
+  /**
+   * Compute the memory footprint summary of a flattened layout.
+   * This determines the pointer density, the cache line straddling members
+   * and the cache lines spanned by pointer members, which are the ones
+   * dereferenced on hot paths.
+   */
+  void checkFootprint(FlattenedLayout &layout);
+
+  /**
+   * Search for a top-level member ordering that reduces the layout size
+   * while keeping every member at an offset and padded size that give
+   * precise capability bounds.
+   */
+  void checkReorder(FlattenedLayout &layout);
+
+  /**
+   * Compute the layout fingerprint from the flattened members.
+   * This is used to detect layout changes without comparing every member.
+   */
+  void computeFingerprint(FlattenedLayout &layout);
+
   /**
    * Compilation unit currently being scanned
    */
   std::string current_unit_;
 
+  /**
+   * Timing of the per-layout phases, resolved once per job.
+   */
+  TimingInfo &flatten_timing_;
+  TimingInfo &padding_timing_;
+
   /**
    * Flattened layouts.
    * Associate a (file, line) tuple to each flattened layout.
@@ -227,6 +449,41 @@ protected:
    */
   std::unordered_map<LayoutId, std::unique_ptr<FlattenedLayout>, LayoutHash>
       layouts_;
+
+  /**
+   * Cache line size for the footprint analysis.
+   */
+  uint64_t cache_line_size_;
+
+  /**
+   * Whether the ODR check is enabled.
+   */
+  bool odr_check_;
+
+  struct SeenLayout {
+    uint64_t hash;
+    unsigned long long size;
+    std::string unit;
+  };
+
+  /**
+   * Structural hash of the first definition of each layout in the binary.
+   * Unlike layouts_, this persists across compilation units.
+   * This is only used when the ODR check is enabled.
+   */
+  std::unordered_map<LayoutId, SeenLayout, LayoutHash> seen_layouts_;
+
+  /**
+   * ODR conflicts found in the current compilation unit.
+   */
+  std::vector<ODRConflict> odr_conflicts_;
+
+  /**
+   * Top-N heap for this job and the shared heap it is merged into.
+   * When set, layouts are ranked instead of recorded.
+   */
+  std::unique_ptr<TopLayouts> top_;
+  std::shared_ptr<SharedTopLayouts> shared_top_;
 };
 
 } /* namespace cheri */
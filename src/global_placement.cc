@@ -0,0 +1,243 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Alfredo Mazzinghi
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+#include <algorithm>
+#include <bit>
+#include <format>
+#include <map>
+
+#include <QDebug>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QVariant>
+
+#include "global_placement.hh"
+#include "storage.hh"
+
+namespace {
+
+uint64_t alignUp(uint64_t value, uint64_t align) {
+  return ((value + align - 1) / align) * align;
+}
+
+/**
+ * Span of the padded symbols when placed in the given order.
+ */
+template <typename It>
+unsigned long long
+measurePlacement(const std::vector<cheri::PlacementSymbol> &symbols, It begin,
+                 It end) {
+  unsigned long long offset = 0;
+  for (auto it = begin; it != end; ++it) {
+    auto &sym = symbols[*it];
+    offset = alignUp(offset, sym.align) + sym.padded_size;
+  }
+  return offset;
+}
+
+} // namespace
+
+namespace cheri {
+
+uint64_t estimateNaturalAlign(uint64_t size, uint64_t granule) {
+  if (size == 0)
+    return 1;
+  return std::min<uint64_t>(uint64_t(1) << std::countr_zero(size), granule);
+}
+
+std::vector<PlacementSymbol>
+loadPlacementSymbols(LayoutSnapshot &snapshot,
+                     std::optional<std::string> binary) {
+  QSqlQuery q(snapshot.database());
+  q.setForwardOnly(true);
+
+  if (!binary) {
+    if (!q.exec("SELECT COUNT(DISTINCT binary_id) FROM global_sym") ||
+        !q.next()) {
+      qCritical() << "Failed to count binaries:" << q.lastError();
+      throw DBError(q.lastError());
+    }
+    if (q.value(0).toULongLong() > 1) {
+      qCritical() << "Database contains multiple binaries, select one";
+      throw std::runtime_error("Ambiguous binary for placement");
+    }
+    q.finish();
+  }
+
+  // clang-format off
+  q.prepare("SELECT g.name, g.section, g.addr, g.size, g.required_align, "
+            "g.padded_size, COALESCE(g.linkage_name, g.name), g.is_external, "
+            "b.cap_size FROM global_sym g "
+            "JOIN binary b ON g.binary_id = b.id "
+            "WHERE g.section IS NOT NULL AND "
+            "(:binary IS NULL OR b.file = :match_binary) "
+            "ORDER BY g.addr");
+  // clang-format on
+  QVariant binary_file = binary ? QVariant(QString::fromStdString(*binary))
+                                : QVariant::fromValue(nullptr);
+  q.bindValue(":binary", binary_file);
+  q.bindValue(":match_binary", binary_file);
+  if (!q.exec()) {
+    qCritical() << "Failed to load global symbols:" << q.lastError();
+    throw DBError(q.lastError());
+  }
+
+  std::vector<PlacementSymbol> symbols;
+  while (q.next()) {
+    PlacementSymbol sym;
+    sym.name = q.value(0).toString().toStdString();
+    sym.section = q.value(1).toString().toStdString();
+    sym.addr = q.value(2).toULongLong();
+    sym.size = q.value(3).toULongLong();
+    sym.padded_size = std::max(q.value(5).toULongLong(), sym.size);
+    // The capability size bounds the natural alignment of the symbols
+    uint64_t granule = q.value(8).toULongLong();
+    sym.align = std::max<uint64_t>(q.value(4).toULongLong(),
+                                   estimateNaturalAlign(sym.size, granule));
+    sym.linkage_name = q.value(6).toString().toStdString();
+    sym.is_external = q.value(7).toBool();
+    symbols.push_back(std::move(sym));
+  }
+  return symbols;
+}
+
+std::vector<SectionPlacement>
+placeSymbols(const std::vector<PlacementSymbol> &symbols) {
+  // Group by section, keeping the sections in address order
+  std::map<std::pair<unsigned long long, std::string>, std::vector<size_t>>
+      by_section;
+  std::map<std::string, unsigned long long> section_start;
+  for (size_t idx = 0; idx < symbols.size(); idx++) {
+    auto &sym = symbols[idx];
+    auto [it, _] = section_start.emplace(sym.section, sym.addr);
+    it->second = std::min(it->second, sym.addr);
+  }
+  for (size_t idx = 0; idx < symbols.size(); idx++) {
+    auto &sym = symbols[idx];
+    by_section[{section_start[sym.section], sym.section}].push_back(idx);
+  }
+
+  std::vector<SectionPlacement> placements;
+  for (auto &[key, indices] : by_section) {
+    SectionPlacement placement;
+    placement.section = key.second;
+
+    std::stable_sort(indices.begin(), indices.end(), [&](size_t l, size_t r) {
+      return symbols[l].addr < symbols[r].addr;
+    });
+    placement.naive_size =
+        measurePlacement(symbols, indices.begin(), indices.end());
+
+    // Only the external symbols can be listed in the ordering file
+    std::vector<size_t> listed;
+    std::vector<size_t> unlisted;
+    for (auto idx : indices) {
+      if (symbols[idx].is_external)
+        listed.push_back(idx);
+      else
+        unlisted.push_back(idx);
+    }
+    std::stable_sort(listed.begin(), listed.end(), [&](size_t l, size_t r) {
+      if (symbols[l].align != symbols[r].align)
+        return symbols[l].align > symbols[r].align;
+      return symbols[l].padded_size > symbols[r].padded_size;
+    });
+
+    // First fit, each symbol goes to the first hole left by the alignment
+    // of the previous symbols that can hold it, or at the end.
+    std::vector<std::pair<uint64_t, uint64_t>> holes;
+    std::vector<std::pair<uint64_t, size_t>> placed;
+    uint64_t end = 0;
+    for (auto idx : listed) {
+      auto &sym = symbols[idx];
+      bool in_hole = false;
+      for (auto it = holes.begin(); it != holes.end(); ++it) {
+        uint64_t start = alignUp(it->first, sym.align);
+        if (start + sym.padded_size > it->second)
+          continue;
+        auto hole = *it;
+        it = holes.erase(it);
+        if (start + sym.padded_size < hole.second)
+          it = holes.insert(it, {start + sym.padded_size, hole.second});
+        if (hole.first < start)
+          holes.insert(it, {hole.first, start});
+        placed.emplace_back(start, idx);
+        in_hole = true;
+        break;
+      }
+      if (in_hole)
+        continue;
+      uint64_t start = alignUp(end, sym.align);
+      if (start > end)
+        holes.emplace_back(end, start);
+      placed.emplace_back(start, idx);
+      end = start + sym.padded_size;
+    }
+    std::sort(placed.begin(), placed.end());
+
+    // The linker keeps the unlisted symbols in their original order,
+    // after the listed ones.
+    for (auto &[offset, idx] : placed)
+      placement.order.push_back(idx);
+    placement.order.insert(placement.order.end(), unlisted.begin(),
+                           unlisted.end());
+    placement.placed_size = measurePlacement(symbols, placement.order.begin(),
+                                             placement.order.end());
+    placements.push_back(std::move(placement));
+  }
+  return placements;
+}
+
+void writeOrderingFile(std::ostream &os,
+                       const std::vector<PlacementSymbol> &symbols,
+                       const std::vector<SectionPlacement> &placements) {
+  for (auto &placement : placements) {
+    for (auto idx : placement.order) {
+      auto &sym = symbols[idx];
+      if (!sym.is_external)
+        continue;
+      os << sym.linkage_name << "\n";
+    }
+  }
+}
+
+void writePlacementReport(std::ostream &os,
+                          const std::vector<SectionPlacement> &placements) {
+  long long total_saved = 0;
+  for (auto &placement : placements) {
+    total_saved += placement.saved();
+    os << std::format("{} {} symbols, padded size {:#x} -> {:#x} ({:+d})\n",
+                      placement.section, placement.order.size(),
+                      placement.naive_size, placement.placed_size,
+                      -placement.saved());
+  }
+  os << std::format("{} sections, total bytes saved {}\n", placements.size(),
+                    total_saved);
+}
+
+} /* namespace cheri */
@@ -0,0 +1,132 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Alfredo Mazzinghi
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "layout_snapshot.hh"
+
+namespace cheri {
+
+/**
+ * Global symbol as seen by the placement optimizer.
+ */
+struct PlacementSymbol {
+  PlacementSymbol()
+      : addr(0), size(0), padded_size(0), align(1), is_external(false) {}
+
+  std::string name;
+  // Name of the symbol in the symbol table
+  std::string linkage_name;
+  std::string section;
+  unsigned long long addr;
+  unsigned long long size;
+  // Padded length required for exact bounds
+  unsigned long long padded_size;
+  // Alignment required for exact bounds and natural alignment
+  uint64_t align;
+  // Whether the symbol is visible outside of its compilation unit
+  bool is_external;
+};
+
+/**
+ * Placement of the symbols of a section.
+ */
+struct SectionPlacement {
+  SectionPlacement() : naive_size(0), placed_size(0) {}
+
+  std::string section;
+  // Indices of the section symbols in placement order
+  std::vector<size_t> order;
+  // Span of the padded symbols in the original address order
+  unsigned long long naive_size;
+  // Span of the padded symbols in the suggested order
+  unsigned long long placed_size;
+
+  long long saved() const {
+    return static_cast<long long>(naive_size) -
+           static_cast<long long>(placed_size);
+  }
+};
+
+/**
+ * Natural alignment of a symbol, which is not recorded in the database.
+ * This is estimated as the largest power of two that divides the size,
+ * capped to the given granule.
+ */
+uint64_t estimateNaturalAlign(uint64_t size, uint64_t granule);
+
+/**
+ * Load the global symbols of a binary from a global-sym database.
+ * If the binary is not given, the database must contain a single binary.
+ * Symbols outside of the data sections are ignored.
+ * The natural alignment is capped to the capability size of the binary.
+ */
+std::vector<PlacementSymbol>
+loadPlacementSymbols(LayoutSnapshot &snapshot,
+                     std::optional<std::string> binary);
+
+/**
+ * Find a placement of the symbols in each section that minimizes the
+ * padding needed to give every symbol exact bounds.
+ *
+ * The external symbols are sorted by decreasing alignment and by
+ * decreasing padded size within each alignment, then placed first fit:
+ * each symbol goes to the first alignment hole that can hold it, or at
+ * the end. This is O(n * holes), holes are rare as most padded sizes are
+ * multiples of the alignment.
+ * Local symbols can not be listed in the ordering file, so they keep
+ * their address order after the external symbols, as the linker does.
+ * The placed size covers all the symbols, so the savings are those of
+ * the written ordering file.
+ */
+std::vector<SectionPlacement>
+placeSymbols(const std::vector<PlacementSymbol> &symbols);
+
+/**
+ * Write a symbol ordering file, one linkage name per line.
+ * Local symbols are skipped, their names may be mangled by the compiler
+ * and are ambiguous across compilation units. This includes the anonymous
+ * symbols, which have no linker name.
+ */
+void writeOrderingFile(std::ostream &os,
+                       const std::vector<PlacementSymbol> &symbols,
+                       const std::vector<SectionPlacement> &placements);
+
+/**
+ * Write a human-readable report of the bytes saved in each section.
+ */
+void writePlacementReport(std::ostream &os,
+                          const std::vector<SectionPlacement> &placements);
+
+} /* namespace cheri */
@@ -26,6 +26,9 @@
  */
 #include <QVariant>
 
+#include <algorithm>
+#include <numeric>
+
 #include "llvm/DebugInfo/DWARF/DWARFExpression.h"
 #include "llvm/Support/DataExtractor.h"
 
@@ -36,17 +39,136 @@ using FLIKind = llvm::DILineInfoSpecifier::FileLineInfoKind;
 
 namespace cheri {
 
+namespace {
+
+/*
+ * Estimated heap memory owned by a global symbol description.
+ */
+uint64_t infoHeapBytes(const GlobalSymInfo &info) {
+  uint64_t bytes = estimateHeapBytes(info.file) + estimateHeapBytes(info.name) +
+                   estimateHeapBytes(info.type_name);
+  if (info.linkage_name)
+    bytes += estimateHeapBytes(*info.linkage_name);
+  if (info.section)
+    bytes += estimateHeapBytes(*info.section);
+  if (info.type_file)
+    bytes += estimateHeapBytes(*info.type_file);
+  return bytes;
+}
+
+} // namespace
+
+std::vector<SymbolExposure>
+findExposures(const std::vector<SymbolExtent> &symbols) {
+  std::vector<SymbolExposure> exposures;
+  std::vector<size_t> by_addr(symbols.size());
+  std::iota(by_addr.begin(), by_addr.end(), 0);
+  std::sort(by_addr.begin(), by_addr.end(), [&symbols](size_t l, size_t r) {
+    return symbols[l].addr < symbols[r].addr;
+  });
+
+  // Running maximum of the symbol end addresses in address order, so that
+  // the backward scan can stop as soon as no earlier symbol reaches the base.
+  std::vector<uint64_t> max_end(by_addr.size());
+  uint64_t running_end = 0;
+  for (size_t i = 0; i < by_addr.size(); i++) {
+    auto &sym = symbols[by_addr[i]];
+    running_end = std::max(running_end, sym.addr + sym.size);
+    max_end[i] = running_end;
+  }
+
+  auto check = [&](size_t sym_idx, size_t other_idx) {
+    auto &sym = symbols[sym_idx];
+    auto &other = symbols[other_idx];
+    uint64_t base = std::max(sym.base, other.addr);
+    uint64_t top = std::min(sym.top, other.addr + other.size);
+    if (base < top)
+      exposures.push_back({sym_idx, other_idx, base, top});
+  };
+
+  for (size_t i = 0; i < by_addr.size(); i++) {
+    auto &sym = symbols[by_addr[i]];
+    if (sym.base == sym.addr && sym.top == sym.addr + sym.size)
+      continue;
+
+    for (size_t j = i; j-- > 0 && max_end[j] > sym.base;)
+      check(by_addr[i], by_addr[j]);
+    for (size_t j = i + 1;
+         j < by_addr.size() && symbols[by_addr[j]].addr < sym.top; j++)
+      check(by_addr[i], by_addr[j]);
+  }
+  return exposures;
+}
+
+std::vector<SectionOverhead>
+estimateSectionOverhead(const std::vector<SectionInfo> &sections,
+                        std::vector<const GlobalSymInfo *> symbols,
+                        uint64_t granule) {
+  std::vector<SectionOverhead> overhead;
+  std::sort(symbols.begin(), symbols.end(),
+            [](auto *l, auto *r) { return l->addr < r->addr; });
+
+  auto it = symbols.begin();
+  for (auto &section : sections) {
+    SectionOverhead result;
+    result.section = section.name;
+    result.addr = section.addr;
+    result.size = section.size;
+
+    // Skip symbols that are not in any section
+    while (it != symbols.end() && (*it)->addr < section.addr)
+      ++it;
+
+    uint64_t shift = 0;
+    for (; it != symbols.end() && (*it)->addr < section.addr + section.size;
+         ++it) {
+      auto *sym = *it;
+      // Symbols that were aligned may become misaligned due to the shift
+      uint64_t align = std::max<uint64_t>(sym->required_align, 1);
+      uint64_t new_addr = sym->addr + shift;
+      uint64_t pad = sym->padded_size - sym->size;
+      if (new_addr % align == 0 && pad == 0)
+        continue;
+      result.imprecise_syms++;
+
+      uint64_t aligned = ((new_addr + align - 1) / align) * align;
+      uint64_t next_shift = shift + (aligned - new_addr) + pad;
+      next_shift = ((next_shift + granule - 1) / granule) * granule;
+
+      result.pad_bytes += pad;
+      result.align_bytes += next_shift - shift - pad;
+      shift = next_shift;
+    }
+    if (result.imprecise_syms)
+      overhead.push_back(std::move(result));
+  }
+  return overhead;
+}
+
 void GlobalSymScraper::initSchema() {
   // clang-format off
   /* Initialize tables */
+  initBinarySchema();
+
   sm_.query_tx("CREATE TABLE IF NOT EXISTS global_sym ("
             "id INTEGER PRIMARY KEY,"
+            // Binary ID where the symbol is found
+            "binary_id INTEGER NOT NULL,"
             // File where the symbol is defined
             "file TEXT NOT NULL,"
             // Line where the symbol is defined
             "line INTEGER NOT NULL,"
             // Name of the symbol.
             "name TEXT NOT NULL,"
+            // Linkage name of the symbol, NULL if it is the name
+            "linkage_name TEXT,"
+            // Whether the symbol is visible outside of its unit
+            "is_external INTEGER DEFAULT 0 NOT NULL"
+            " CHECK(is_external >= 0 AND is_external <= 1),"
+            // Symbol address in the binary (not relocated)
+            "addr INTEGER NOT NULL,"
+            // Data section containing the symbol, if known
+            "section TEXT,"
             // Size in bytes
             "size INTEGER NOT NULL,"
             // If not NULL, a sized array with the given number of items
@@ -55,10 +177,75 @@ void GlobalSymScraper::initSchema() {
             "cap_alignment INTEGER NOT NULL,"
             // Representable symbol length
             "cap_length INTEGER NOT NULL,"
+            // Minimum alignment required for exact bounds, in bytes
+            "required_align INTEGER DEFAULT 0 NOT NULL,"
+            // Padded length required for exact bounds
+            "padded_size INTEGER DEFAULT 0 NOT NULL,"
+            // Storage growth to make the symbol precise, NULL if precise
+            "layout_size_delta INTEGER,"
             // Whether the symbol size is representable
             "is_imprecise INTEGER DEFAULT 0 NOT NULL"
             " CHECK(is_imprecise >= 0 AND is_imprecise <= 1),"
-            "UNIQUE(name, file, line))");
+            // Type of the symbol
+            "type_name TEXT NOT NULL,"
+            // Definition of the aggregate type, NULL for scalar types
+            "type_file TEXT,"
+            "type_line INTEGER,"
+            // Number of instances of the type, the array items for arrays
+            "instances INTEGER DEFAULT 1 NOT NULL,"
+            "FOREIGN KEY (binary_id) REFERENCES binary (id),"
+            "UNIQUE(binary_id, name, file, line))");
+
+  sm_.query_tx("CREATE INDEX IF NOT EXISTS global_sym_type ON "
+            "global_sym (binary_id, type_file, type_line)");
+
+  /*
+   * Static instances of each layout found by the flat-layout scraper.
+   * The growth is a lower bound on the bytes added to make every
+   * imprecise member of all the instances precise.
+   */
+  sm_.query_tx("CREATE VIEW IF NOT EXISTS layout_static_instances AS "
+            "SELECT tl.id AS owner, tl.binary_id, tl.name,"
+            " COUNT(g.id) AS globals,"
+            " SUM(g.instances) AS instances,"
+            " SUM(g.instances) * tl.size AS static_bytes,"
+            " (SELECT COUNT(*) FROM layout_member m"
+            "  WHERE m.owner = tl.id AND m.is_imprecise) AS imprecise_members,"
+            " SUM(g.instances) * (SELECT COALESCE(MAX(m.layout_size_delta), 0)"
+            "  FROM layout_member m WHERE m.owner = tl.id) AS growth_bytes "
+            "FROM type_layout tl JOIN global_sym g ON"
+            " g.binary_id = tl.binary_id AND g.type_file = tl.file AND"
+            " g.type_line = tl.line "
+            "GROUP BY tl.id");
+
+  sm_.query_tx("CREATE TABLE IF NOT EXISTS global_sym_exposure ("
+            // FK of the symbol with imprecise capability bounds
+            "sym INTEGER NOT NULL,"
+            // FK of the neighbor symbol reachable through the capability
+            "neighbor INTEGER NOT NULL,"
+            // Range of the neighbor bytes that are exposed
+            "exposed_base INTEGER NOT NULL,"
+            "exposed_top INTEGER NOT NULL,"
+            "PRIMARY KEY (sym, neighbor),"
+            "FOREIGN KEY (sym) REFERENCES global_sym (id),"
+            "FOREIGN KEY (neighbor) REFERENCES global_sym (id))");
+
+  sm_.query_tx("CREATE TABLE IF NOT EXISTS global_section_overhead ("
+            "id INTEGER PRIMARY KEY,"
+            "binary_id INTEGER NOT NULL,"
+            "section TEXT NOT NULL,"
+            "section_addr INTEGER NOT NULL,"
+            "section_size INTEGER NOT NULL,"
+            // Number of symbols that need alignment or padding
+            "imprecise_syms INTEGER NOT NULL,"
+            // Bytes added by aligning the imprecise symbols
+            "align_bytes INTEGER NOT NULL,"
+            // Bytes added by padding the imprecise symbols length
+            "pad_bytes INTEGER NOT NULL,"
+            // Estimated section growth
+            "growth INTEGER NOT NULL,"
+            "FOREIGN KEY (binary_id) REFERENCES binary (id),"
+            "UNIQUE(binary_id, section))");
   // clang-format on
 }
 
@@ -85,12 +272,52 @@ void GlobalSymScraper::endUnit(llvm::DWARFDie &unit_die) {
   for (auto i = globals_.begin(); i != globals_.end(); i++) {
     GlobalSymInfo info;
     std::swap(i->second, info);
-    recordInfo(std::move(info));
+    stats_.globals++;
+    if (info.size != info.cap_length) {
+      stats_.imprecise_globals++;
+    }
+    if (dry_run_) {
+      continue;
+    }
+    auto id = recordInfo(info);
+    symbols_heap_bytes_ += infoHeapBytes(info);
+    symbols_.emplace(id.toLongLong(), std::move(info));
   }
 
   globals_.clear();
 }
 
+void GlobalSymScraper::endRun() {
+  if (!symbols_.empty()) {
+    recordExposures();
+    recordSectionOverhead();
+  }
+  symbols_.clear();
+  symbols_heap_bytes_ = 0;
+}
+
+uint64_t GlobalSymScraper::stateBytes() const {
+  uint64_t bytes = estimateTableBytes(globals_) + estimateTableBytes(symbols_) +
+                   symbols_heap_bytes_;
+  for (auto &[id, info] : globals_) {
+    bytes += estimateHeapBytes(std::get<0>(id)) +
+             estimateHeapBytes(std::get<1>(id)) + infoHeapBytes(info);
+  }
+  return bytes;
+}
+
+std::optional<std::string> GlobalSymScraper::findSection(uint64_t addr) const {
+  auto it = std::upper_bound(
+      sections_.begin(), sections_.end(), addr,
+      [](uint64_t value, const SectionInfo &s) { return value < s.addr; });
+  if (it == sections_.begin())
+    return std::nullopt;
+  --it;
+  if (addr >= it->addr + it->size)
+    return std::nullopt;
+  return it->name;
+}
+
 std::optional<uint64_t> GlobalSymScraper::getGlobalAddr(llvm::DWARFDie &die) {
   // Verify that this is a global variable
   // We match the exact expression DW_OP_addr(x) [DW_OP_plus_uconst]
@@ -172,6 +399,12 @@ bool GlobalSymScraper::visit_variable(llvm::DWARFDie &die) {
   } else {
     info.name = *at_name;
   }
+  // Static data members keep these in the declaration inside the class
+  if (const char *linkage_name = die.getLinkageName()) {
+    info.linkage_name = linkage_name;
+  }
+  info.is_external =
+      dwarf::toUnsigned(die.findRecursively(dwarf::DW_AT_external), 0) != 0;
   info.file = die.getDeclFile(FLIKind::AbsoluteFilePath);
   info.line = die.getDeclLine();
 
@@ -191,9 +424,25 @@ bool GlobalSymScraper::visit_variable(llvm::DWARFDie &die) {
   TypeDesc desc = resolveTypeDie(type_die);
   info.size = desc.byte_size;
   info.array_items = desc.array_count;
+  info.type_name = desc.name;
+  if (desc.decl && !desc.pointer) {
+    info.type_file = desc.decl->file;
+    info.type_line = desc.decl->line;
+    info.instances = desc.array_count.value_or(1);
+  }
   info.cap_alignment = source().findRepresentableAlign(info.size);
   auto [_, length] = source().findRepresentableRange(0, info.size);
   info.cap_length = length;
+  std::tie(info.required_align, info.padded_size) =
+      source().findRepresentablePadding(info.size);
+  auto [addr_base, addr_length] =
+      source().findRepresentableRange(info.addr, info.size);
+  info.cap_base = addr_base;
+  info.cap_top = addr_base + addr_length;
+  info.section = findSection(info.addr);
+  if (info.size != info.cap_length) {
+    info.layout_size_delta = info.padded_size - info.size;
+  }
 
   qDebug() << "Found global sym "
            << std::format("{}:{} {} @{:#x} size={:#x} align={:#x} clen={:#x}",
@@ -206,22 +455,47 @@ bool GlobalSymScraper::visit_variable(llvm::DWARFDie &die) {
   return false;
 }
 
-void GlobalSymScraper::recordInfo(GlobalSymInfo &&info) {
+QVariant GlobalSymScraper::recordInfo(const GlobalSymInfo &info) {
+  QVariant sym_id;
   sm_.transaction([&](StorageManager &sm) {
     qDebug() << "Transaction for" << info.name;
 
     // clang-format off
     auto insert_info = sm.prepare(
-        "INSERT INTO global_sym (file, line, name, size, array_items, "
-        "cap_alignment, cap_length, is_imprecise) "
-        "VALUES (:file, :line, :name, :size, :array_items, :cap_align, "
-        ":cap_len, :is_imprecise) "
+        "INSERT INTO global_sym (binary_id, file, line, name, linkage_name, "
+        "is_external, addr, section, size, array_items, cap_alignment, "
+        "cap_length, required_align, padded_size, layout_size_delta, "
+        "is_imprecise, type_name, type_file, type_line, instances) "
+        "VALUES (:binary_id, :file, :line, :name, :linkage_name, "
+        ":is_external, :addr, :section, :size, :array_items, :cap_align, "
+        ":cap_len, :required_align, :padded_size, :layout_size_delta, "
+        ":is_imprecise, :type_name, :type_file, :type_line, :instances) "
         "ON CONFLICT DO NOTHING RETURNING id");
+
+    auto fetch_info = sm.prepare(
+        "SELECT id FROM global_sym WHERE "
+        "binary_id = :binary_id AND name = :name AND file = :file AND line = :line");
     // clang-format on
 
+    QVariant binary_id = recordBinary(sm);
+
+    insert_info.bindValue(":binary_id", binary_id);
     insert_info.bindValue(":file", QString::fromStdString(info.file));
     insert_info.bindValue(":line", info.line);
     insert_info.bindValue(":name", QString::fromStdString(info.name));
+    if (info.linkage_name) {
+      insert_info.bindValue(":linkage_name",
+                            QString::fromStdString(*info.linkage_name));
+    } else {
+      insert_info.bindValue(":linkage_name", QVariant::fromValue(nullptr));
+    }
+    insert_info.bindValue(":is_external", info.is_external);
+    insert_info.bindValue(":addr", info.addr);
+    if (info.section) {
+      insert_info.bindValue(":section", QString::fromStdString(*info.section));
+    } else {
+      insert_info.bindValue(":section", QVariant::fromValue(nullptr));
+    }
     insert_info.bindValue(":size", info.size);
     if (info.array_items) {
       insert_info.bindValue(":array_items", *info.array_items);
@@ -232,16 +506,141 @@ void GlobalSymScraper::recordInfo(GlobalSymInfo &&info) {
                           static_cast<unsigned long long>(info.cap_alignment));
     insert_info.bindValue(":cap_len",
                           static_cast<unsigned long long>(info.cap_length));
+    insert_info.bindValue(":required_align",
+                          static_cast<unsigned long long>(info.required_align));
+    insert_info.bindValue(":padded_size", info.padded_size);
+    if (info.layout_size_delta) {
+      insert_info.bindValue(":layout_size_delta", *info.layout_size_delta);
+    } else {
+      insert_info.bindValue(":layout_size_delta", QVariant::fromValue(nullptr));
+    }
     insert_info.bindValue(":is_imprecise", info.size != info.cap_length);
-    if (!insert_info.exec()) {
+    insert_info.bindValue(":type_name", QString::fromStdString(info.type_name));
+    if (info.type_file) {
+      insert_info.bindValue(":type_file",
+                            QString::fromStdString(*info.type_file));
+      insert_info.bindValue(":type_line", info.type_line);
+    } else {
+      insert_info.bindValue(":type_file", QVariant::fromValue(nullptr));
+      insert_info.bindValue(":type_line", QVariant::fromValue(nullptr));
+    }
+    insert_info.bindValue(":instances", info.instances);
+    if (!sm.exec(insert_info)) {
       // Failed, abort the transaction
       qCritical() << "Failed to insert global info:" << insert_info.lastQuery();
       throw DBError(insert_info.lastError());
     }
+    if (!insert_info.first()) {
+      fetch_info.bindValue(":binary_id", binary_id);
+      fetch_info.bindValue(":name", QString::fromStdString(info.name));
+      fetch_info.bindValue(":file", QString::fromStdString(info.file));
+      fetch_info.bindValue(":line", info.line);
+      if (!sm.exec(fetch_info)) {
+        qCritical() << "Failed to fetch global ID:" << fetch_info.lastQuery();
+        throw DBError(fetch_info.lastError());
+      }
+      if (!fetch_info.first()) {
+        qCritical() << "Record for existing global could not be found";
+        throw ScraperError("Unexpected missing global_sym");
+      }
+      sym_id = fetch_info.value(0);
+      fetch_info.finish();
+    } else {
+      sym_id = insert_info.value(0);
+    }
     insert_info.finish();
 
     qDebug() << "Transaction for" << info.name << "Done";
   });
+  return sym_id;
+}
+
+void GlobalSymScraper::recordExposures() {
+  std::vector<qlonglong> ids;
+  std::vector<SymbolExtent> symbols;
+  ids.reserve(symbols_.size());
+  symbols.reserve(symbols_.size());
+  for (auto &[id, info] : symbols_) {
+    ids.push_back(id);
+    symbols.push_back({info.addr, info.size, info.cap_base, info.cap_top});
+  }
+
+  auto exposures = findExposures(symbols);
+  qDebug() << "Found" << exposures.size() << "global symbol exposures";
+  if (exposures.empty())
+    return;
+
+  sm_.transaction([&](StorageManager &sm) {
+    // clang-format off
+    auto insert_exposure = sm.prepare(
+        "INSERT INTO global_sym_exposure (sym, neighbor, exposed_base, exposed_top) "
+        "VALUES (:sym, :neighbor, :exposed_base, :exposed_top) "
+        "ON CONFLICT DO NOTHING");
+    // clang-format on
+
+    for (auto &exposure : exposures) {
+      insert_exposure.bindValue(":sym", ids[exposure.sym]);
+      insert_exposure.bindValue(":neighbor", ids[exposure.neighbor]);
+      insert_exposure.bindValue(":exposed_base",
+                                static_cast<unsigned long long>(exposure.base));
+      insert_exposure.bindValue(":exposed_top",
+                                static_cast<unsigned long long>(exposure.top));
+      if (!sm.exec(insert_exposure)) {
+        qCritical() << "Failed to insert global exposure:"
+                    << insert_exposure.lastQuery();
+        throw DBError(insert_exposure.lastError());
+      }
+      insert_exposure.finish();
+    }
+  });
+}
+
+void GlobalSymScraper::recordSectionOverhead() {
+  std::vector<const GlobalSymInfo *> symbols;
+  symbols.reserve(symbols_.size());
+  for (auto &[id, info] : symbols_)
+    symbols.push_back(&info);
+
+  auto overhead = estimateSectionOverhead(sections_, std::move(symbols),
+                                          source().getABICapabilitySize());
+  if (overhead.empty())
+    return;
+
+  sm_.transaction([&](StorageManager &sm) {
+    // clang-format off
+    auto insert_overhead = sm.prepare(
+        "INSERT INTO global_section_overhead (binary_id, section, "
+        "section_addr, section_size, imprecise_syms, align_bytes, pad_bytes, "
+        "growth) "
+        "VALUES (:binary_id, :section, :section_addr, :section_size, "
+        ":imprecise_syms, :align_bytes, :pad_bytes, :growth) "
+        "ON CONFLICT DO NOTHING");
+    // clang-format on
+
+    QVariant binary_id = recordBinary(sm);
+    for (auto &entry : overhead) {
+      qDebug() << "Section" << entry.section
+               << std::format("grows by {:#x} for {} imprecise symbols",
+                              entry.growth(), entry.imprecise_syms);
+      insert_overhead.bindValue(":binary_id", binary_id);
+      insert_overhead.bindValue(":section",
+                                QString::fromStdString(entry.section));
+      insert_overhead.bindValue(":section_addr",
+                                static_cast<unsigned long long>(entry.addr));
+      insert_overhead.bindValue(":section_size",
+                                static_cast<unsigned long long>(entry.size));
+      insert_overhead.bindValue(":imprecise_syms", entry.imprecise_syms);
+      insert_overhead.bindValue(":align_bytes", entry.align_bytes);
+      insert_overhead.bindValue(":pad_bytes", entry.pad_bytes);
+      insert_overhead.bindValue(":growth", entry.growth());
+      if (!sm.exec(insert_overhead)) {
+        qCritical() << "Failed to insert section overhead:"
+                    << insert_overhead.lastQuery();
+        throw DBError(insert_overhead.lastError());
+      }
+      insert_overhead.finish();
+    }
+  });
 }
 
 } /* namespace cheri */
@@ -30,6 +30,7 @@
 #include <cstdint>
 #include <unordered_map>
 #include <variant>
+#include <vector>
 
 #include "scraper.hh"
 
@@ -39,7 +40,9 @@ using SymbolId = std::tuple<std::string, std::string, size_t>;
 
 struct GlobalSymInfo {
   GlobalSymInfo()
-      : line(0), addr(0), size(0), cap_alignment(0), cap_length(0) {}
+      : line(0), addr(0), size(0), cap_alignment(0), cap_length(0),
+        required_align(0), padded_size(0), cap_base(0), cap_top(0),
+        type_line(0), instances(1), is_external(false) {}
   SymbolId id() const { return std::make_tuple(name, file, line); }
 
   // Source file where the symbol is defined
@@ -50,6 +53,8 @@ struct GlobalSymInfo {
   unsigned long long addr;
   // Name of the symbol
   std::string name;
+  // Linkage name of the symbol, if different from the name
+  std::optional<std::string> linkage_name;
   // Symbol size (requested size)
   unsigned long long size;
   // Symbol array items, if any
@@ -58,8 +63,94 @@ struct GlobalSymInfo {
   uint64_t cap_alignment;
   // Capability size required
   uint64_t cap_length;
+  // Minimum alignment required for exact bounds, in bytes
+  uint64_t required_align;
+  // Padded length required for exact bounds
+  unsigned long long padded_size;
+  // If the symbol is imprecise, the storage growth required to make it precise
+  std::optional<unsigned long long> layout_size_delta;
+  // Representable capability bounds at the symbol address
+  uint64_t cap_base;
+  uint64_t cap_top;
+  // Data section containing the symbol, if any
+  std::optional<std::string> section;
+  // Type of the symbol
+  std::string type_name;
+  // Definition of the aggregate type of the symbol or of its array
+  // elements, this matches the (file, line) of the type_layout entry.
+  std::optional<std::string> type_file;
+  unsigned long long type_line;
+  // Number of instances of the type, the array items for arrays
+  unsigned long long instances;
+  // Whether the symbol is visible outside of its compilation unit
+  bool is_external;
 };
 
+/**
+ * Address range of a global symbol and of its capability.
+ */
+struct SymbolExtent {
+  uint64_t addr;
+  uint64_t size;
+  // Representable capability bounds [base, top) for the symbol
+  uint64_t base;
+  uint64_t top;
+};
+
+/**
+ * Bytes of a neighbor symbol reachable through an imprecise capability.
+ * The symbols are identified by their index in the input extents.
+ */
+struct SymbolExposure {
+  size_t sym;
+  size_t neighbor;
+  uint64_t base;
+  uint64_t top;
+};
+
+/**
+ * Find the neighbors that overlap with the capability bounds of each
+ * imprecise symbol.
+ * The symbols are sorted by address and swept once, so this runs in
+ * O(n log n) plus the number of exposures found.
+ */
+std::vector<SymbolExposure>
+findExposures(const std::vector<SymbolExtent> &symbols);
+
+/**
+ * Estimated growth of a data section when the imprecise symbols in it
+ * are aligned and padded for exact bounds.
+ */
+struct SectionOverhead {
+  SectionOverhead()
+      : addr(0), size(0), imprecise_syms(0), align_bytes(0), pad_bytes(0) {}
+
+  std::string section;
+  uint64_t addr;
+  uint64_t size;
+  // Number of symbols that need alignment or padding
+  unsigned long long imprecise_syms;
+  // Bytes added to align the symbols and the following ones
+  unsigned long long align_bytes;
+  // Bytes added to pad the symbol lengths
+  unsigned long long pad_bytes;
+
+  unsigned long long growth() const { return align_bytes + pad_bytes; }
+};
+
+/**
+ * Simulate the layout of the symbols in each section, in address order,
+ * when every symbol is aligned to its required alignment and padded to its
+ * representable length.
+ * Symbols keep their relative gaps, and the shift of the following symbols
+ * is kept a multiple of the granule so that their natural alignment is
+ * preserved. This gives an upper bound on the growth of each section.
+ */
+std::vector<SectionOverhead>
+estimateSectionOverhead(const std::vector<SectionInfo> &sections,
+                        std::vector<const GlobalSymInfo *> symbols,
+                        uint64_t granule);
+
 struct SymbolHash {
   std::size_t operator()(const SymbolId &k) const noexcept {
     std::size_t h0 = std::hash<std::string>{}(std::get<0>(k));
@@ -79,7 +170,8 @@ struct SymbolHash {
 class GlobalSymScraper : public DwarfScraper {
 public:
   GlobalSymScraper(StorageManager &sm, std::unique_ptr<const DwarfSource> dwsrc)
-      : DwarfScraper(sm, std::move(dwsrc)) {}
+      : DwarfScraper(sm, std::move(dwsrc)), symbols_heap_bytes_(0),
+        sections_(source().getDataSections()) {}
 
   std::string name() override { return "global-var"; }
 
@@ -89,6 +181,8 @@ protected:
   void initSchema() override;
   void beginUnit(llvm::DWARFDie &unit_die) override;
   void endUnit(llvm::DWARFDie &unit_die) override;
+  void endRun() override;
+  uint64_t stateBytes() const override;
   bool doVisit(llvm::DWARFDie &die) override {
     return impl::visitDispatch(*this, die);
   }
@@ -101,8 +195,24 @@ protected:
 
   /**
    * Write a global variable info descriptor to the database.
+   * Returns the ID of the global_sym row.
    */
-  void recordInfo(GlobalSymInfo &&info);
+  QVariant recordInfo(const GlobalSymInfo &info);
+
+  /**
+   * Write the neighbor exposures of the imprecise symbols to the database.
+   */
+  void recordExposures();
+
+  /**
+   * Write the estimated section growth due to symbol padding.
+   */
+  void recordSectionOverhead();
+
+  /**
+   * Find the data section containing an address.
+   */
+  std::optional<std::string> findSection(uint64_t addr) const;
 
   /**
    * Globals information.
@@ -117,6 +227,22 @@ protected:
    * Compilation unit currently processed
    */
   std::string current_unit_;
+
+  /**
+   * Every global recorded for this binary, by global_sym ID.
+   * This persists across compilation units for the binary-wide passes.
+   */
+  std::unordered_map<qlonglong, GlobalSymInfo> symbols_;
+  /**
+   * Estimated heap memory owned by the symbols_ entries, this is
+   * kept up to date so that we do not scan symbols_ at every unit.
+   */
+  uint64_t symbols_heap_bytes_;
+
+  /**
+   * Data sections of the binary, sorted by address.
+   */
+  std::vector<SectionInfo> sections_;
 };
 
 } /* namespace cheri */
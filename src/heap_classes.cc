@@ -0,0 +1,201 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Alfredo Mazzinghi
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+#include <algorithm>
+#include <bit>
+#include <format>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include <QDebug>
+
+#include "heap_classes.hh"
+
+namespace {
+
+uint64_t alignUp(uint64_t value, uint64_t align) {
+  return ((value + align - 1) / align) * align;
+}
+
+uint64_t parseNumber(const std::string &token, unsigned long lineno) {
+  size_t end = 0;
+  uint64_t value = 0;
+  try {
+    value = std::stoull(token, &end, /*base=*/0);
+  } catch (const std::logic_error &) {
+    end = 0;
+  }
+  if (end == 0 || end != token.size()) {
+    qCritical() << "Invalid size class number" << token.c_str() << "at line"
+                << lineno;
+    throw std::runtime_error("Invalid size class table");
+  }
+  return value;
+}
+
+} // namespace
+
+namespace cheri {
+
+std::vector<SizeClass> parseSizeClasses(std::istream &is, uint64_t page_size) {
+  std::vector<SizeClass> classes;
+  std::string line;
+  unsigned long lineno = 0;
+  while (std::getline(is, line)) {
+    lineno++;
+    if (auto comment = line.find('#'); comment != std::string::npos)
+      line.erase(comment);
+
+    std::istringstream fields(line);
+    std::string size_field, align_field, extra;
+    if (!(fields >> size_field))
+      continue;
+    fields >> align_field;
+    if (fields >> extra) {
+      qCritical() << "Unexpected size class field" << extra.c_str()
+                  << "at line" << lineno;
+      throw std::runtime_error("Invalid size class table");
+    }
+
+    SizeClass sc;
+    sc.size = parseNumber(size_field, lineno);
+    if (sc.size == 0) {
+      qCritical() << "Invalid empty size class at line" << lineno;
+      throw std::runtime_error("Invalid size class table");
+    }
+    if (align_field.empty()) {
+      sc.align = std::min<uint64_t>(uint64_t(1) << std::countr_zero(sc.size),
+                                    page_size);
+    } else {
+      sc.align = parseNumber(align_field, lineno);
+      if (!std::has_single_bit(sc.align)) {
+        qCritical() << "Size class alignment must be a power of two at line"
+                    << lineno;
+        throw std::runtime_error("Invalid size class table");
+      }
+    }
+    classes.push_back(sc);
+  }
+
+  std::sort(classes.begin(), classes.end(),
+            [](auto &l, auto &r) { return l.size < r.size; });
+  return classes;
+}
+
+SizeClass selectSizeClass(const std::vector<SizeClass> &classes, uint64_t size,
+                          uint64_t page_size) {
+  auto it = std::lower_bound(
+      classes.begin(), classes.end(), size,
+      [](const SizeClass &sc, uint64_t value) { return sc.size < value; });
+  if (it != classes.end())
+    return *it;
+  return SizeClass(alignUp(std::max<uint64_t>(size, 1), page_size),
+                   page_size);
+}
+
+bool isPreciseMember(const SnapshotMember &member, uint64_t base_align) {
+  if (member.padded_size != 0 && member.padded_size != member.byte_size)
+    return false;
+  uint64_t align = std::max<uint64_t>(member.required_align, 1);
+  return align <= base_align && member.byte_offset % align == 0;
+}
+
+std::vector<HeapClassInfo>
+analyzeHeapClasses(const std::vector<SnapshotLayout> &layouts,
+                   const std::vector<SizeClass> &classes, CapFormat format,
+                   uint64_t page_size, unsigned long workers) {
+  std::vector<HeapClassInfo> results(layouts.size());
+
+  auto analyze = [&](size_t begin, size_t end) {
+    for (size_t idx = begin; idx < end; idx++) {
+      auto &layout = layouts[idx];
+      auto &info = results[idx];
+      info.owner = layout.id;
+      info.name = layout.name;
+      info.file = layout.file;
+      info.line = layout.line;
+      info.size = layout.size;
+
+      auto sc = selectSizeClass(classes, layout.size, page_size);
+      info.class_size = sc.size;
+      info.class_align = sc.align;
+      std::tie(info.required_align, info.cap_length) =
+          findRepresentablePadding(format, sc.size);
+
+      for (auto &m : layout.members) {
+        // Bitfields can not be bounded on their own
+        if (m.bit_size != 0)
+          continue;
+        info.members++;
+        if (!isPreciseMember(m, sc.align))
+          info.imprecise_members++;
+      }
+    }
+  };
+
+  workers = std::clamp<size_t>(workers, 1,
+                               std::max<size_t>(layouts.size(), 1));
+  size_t chunk = (layouts.size() + workers - 1) / workers;
+  {
+    std::vector<std::jthread> threads;
+    for (size_t begin = 0; begin < layouts.size(); begin += chunk) {
+      threads.emplace_back(analyze, begin,
+                           std::min(begin + chunk, layouts.size()));
+    }
+  }
+  return results;
+}
+
+void writeHeapClassReport(std::ostream &os,
+                          std::vector<HeapClassInfo> results) {
+  std::sort(results.begin(), results.end(), [](auto &l, auto &r) {
+    return l.overhead() > r.overhead();
+  });
+
+  unsigned long long imprecise_allocs = 0;
+  unsigned long long imprecise_layouts = 0;
+  for (auto &info : results) {
+    if (!info.isPreciseAlloc())
+      imprecise_allocs++;
+    if (info.imprecise_members)
+      imprecise_layouts++;
+    os << std::format("{} {}:{} size {:#x} class {:#x} align {:#x} "
+                      "bounds {:#x} (+{:#x}){} {}/{} imprecise members\n",
+                      info.name, info.file, info.line, info.size,
+                      info.class_size, info.class_align, info.cap_length,
+                      info.overhead(),
+                      info.isPreciseAlloc() ? "" : " imprecise",
+                      info.imprecise_members, info.members);
+  }
+  os << std::format("{} layouts, {} imprecise allocations, {} with imprecise "
+                    "members\n",
+                    results.size(), imprecise_allocs, imprecise_layouts);
+}
+
+} /* namespace cheri */
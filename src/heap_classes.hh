@@ -0,0 +1,122 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Alfredo Mazzinghi
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "layout_snapshot.hh"
+#include "scraper.hh"
+
+namespace cheri {
+
+/**
+ * Allocator size class.
+ */
+struct SizeClass {
+  SizeClass() : size(0), align(0) {}
+  SizeClass(uint64_t size, uint64_t align) : size(size), align(align) {}
+
+  uint64_t size;
+  // Alignment of the allocations returned for this class
+  uint64_t align;
+};
+
+/**
+ * Parse a size class table, one class per line in the form "SIZE [ALIGN]".
+ * Numbers may be decimal or 0x-prefixed hex, '#' starts a comment.
+ * If the alignment is missing, the class is assumed to be aligned to the
+ * largest power of two that divides the size, capped to the page size, as
+ * jemalloc and snmalloc do.
+ * The classes are returned sorted by size.
+ */
+std::vector<SizeClass> parseSizeClasses(std::istream &is, uint64_t page_size);
+
+/**
+ * Find the class that serves an allocation of the given size.
+ * Allocations larger than every class are rounded to whole pages.
+ */
+SizeClass selectSizeClass(const std::vector<SizeClass> &classes, uint64_t size,
+                          uint64_t page_size);
+
+/**
+ * Representability of heap allocations of a layout.
+ */
+struct HeapClassInfo {
+  HeapClassInfo()
+      : owner(0), line(0), size(0), class_size(0), class_align(0),
+        cap_length(0), required_align(0), members(0), imprecise_members(0) {}
+
+  // Whether the allocation capability has exact bounds on the class size
+  bool isPreciseAlloc() const {
+    return cap_length == class_size && required_align <= class_align;
+  }
+  unsigned long long overhead() const { return cap_length - size; }
+
+  int64_t owner;
+  std::string name;
+  std::string file;
+  unsigned long long line;
+  unsigned long long size;
+  unsigned long long class_size;
+  unsigned long long class_align;
+  // Representable length and alignment for the class size
+  unsigned long long cap_length;
+  unsigned long long required_align;
+  // Members that are not precise relative to the class alignment
+  unsigned long long members;
+  unsigned long long imprecise_members;
+};
+
+/**
+ * Check whether a member can have exact bounds when the layout is allocated
+ * at the given base alignment.
+ */
+bool isPreciseMember(const SnapshotMember &member, uint64_t base_align);
+
+/**
+ * Compute the size class and representability of every layout in the
+ * snapshot, the layout members must be loaded.
+ * The layouts are split across the given number of worker threads.
+ */
+std::vector<HeapClassInfo>
+analyzeHeapClasses(const std::vector<SnapshotLayout> &layouts,
+                   const std::vector<SizeClass> &classes, CapFormat format,
+                   uint64_t page_size, unsigned long workers);
+
+/**
+ * Write a human-readable report of the layouts, sorted by heap overhead.
+ */
+void writeHeapClassReport(std::ostream &os,
+                          std::vector<HeapClassInfo> results);
+
+} /* namespace cheri */
@@ -0,0 +1,108 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Alfredo Mazzinghi
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cmath>
+
+#include "histogram.hh"
+
+namespace cheri {
+
+size_t Histogram::bucketIndex(uint64_t value) {
+  // The first two powers of two are exact
+  if (value < 2 * kSubBuckets)
+    return value;
+  unsigned shift = std::bit_width(value) - 1 - kSubBucketBits;
+  return (shift + 1) * kSubBuckets + (value >> shift) - kSubBuckets;
+}
+
+uint64_t Histogram::bucketLowest(size_t index) {
+  if (index < 2 * kSubBuckets)
+    return index;
+  unsigned shift = index / kSubBuckets - 1;
+  uint64_t sub = index % kSubBuckets + kSubBuckets;
+  return sub << shift;
+}
+
+uint64_t Histogram::bucketHighest(size_t index) {
+  if (index < 2 * kSubBuckets)
+    return index;
+  unsigned shift = index / kSubBuckets - 1;
+  return bucketLowest(index) + (uint64_t(1) << shift) - 1;
+}
+
+void Histogram::record(uint64_t value) {
+  size_t index = bucketIndex(value);
+  if (index >= buckets_.size())
+    buckets_.resize(index + 1, 0);
+  buckets_[index]++;
+  count_++;
+  max_ = std::max(max_, value);
+}
+
+void Histogram::merge(const Histogram &other) {
+  if (other.buckets_.size() > buckets_.size())
+    buckets_.resize(other.buckets_.size(), 0);
+  for (size_t i = 0; i < other.buckets_.size(); i++)
+    buckets_[i] += other.buckets_[i];
+  count_ += other.count_;
+  max_ = std::max(max_, other.max_);
+}
+
+Histogram Histogram::since(const Histogram &before) const {
+  assert(before.buckets_.size() <= buckets_.size() &&
+         "Histogram is not a later copy");
+  Histogram delta;
+  delta.buckets_ = buckets_;
+  for (size_t i = 0; i < before.buckets_.size(); i++)
+    delta.buckets_[i] -= before.buckets_[i];
+  while (!delta.buckets_.empty() && delta.buckets_.back() == 0)
+    delta.buckets_.pop_back();
+  delta.count_ = count_ - before.count_;
+  if (!delta.buckets_.empty())
+    delta.max_ = std::min(max_, bucketHighest(delta.buckets_.size() - 1));
+  return delta;
+}
+
+uint64_t Histogram::percentile(double p) const {
+  if (count_ == 0)
+    return 0;
+  auto rank = static_cast<uint64_t>(std::ceil(p / 100 * count_));
+  rank = std::clamp<uint64_t>(rank, 1, count_);
+  uint64_t seen = 0;
+  for (size_t i = 0; i < buckets_.size(); i++) {
+    seen += buckets_[i];
+    if (seen >= rank)
+      return std::min(max_, bucketHighest(i));
+  }
+  return max_;
+}
+
+} /* namespace cheri */
@@ -0,0 +1,79 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Alfredo Mazzinghi
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace cheri {
+
+/**
+ * HDR-style histogram with log-linear buckets.
+ * Each power of two is split in kSubBuckets linear buckets, so that the
+ * recorded values are reported with a relative error below 1/kSubBuckets.
+ * The buckets are allocated on demand, up to the largest recorded value.
+ */
+class Histogram {
+public:
+  static constexpr unsigned kSubBucketBits = 5;
+  static constexpr uint64_t kSubBuckets = 1 << kSubBucketBits;
+
+  Histogram() : count_(0), max_(0) {}
+
+  void record(uint64_t value);
+  void merge(const Histogram &other);
+
+  /**
+   * Values recorded since an earlier copy of the same histogram.
+   * The maximum is estimated from the highest non-empty bucket.
+   */
+  Histogram since(const Histogram &before) const;
+
+  /**
+   * Value at the given percentile, in [0, 100].
+   * This is the highest value equivalent to the bucket containing the
+   * percentile, and it is never larger than the maximum.
+   */
+  uint64_t percentile(double p) const;
+
+  uint64_t count() const { return count_; }
+  uint64_t max() const { return max_; }
+
+  static size_t bucketIndex(uint64_t value);
+  static uint64_t bucketLowest(size_t index);
+  static uint64_t bucketHighest(size_t index);
+
+private:
+  std::vector<uint64_t> buckets_;
+  uint64_t count_;
+  uint64_t max_;
+};
+
+} /* namespace cheri */
@@ -0,0 +1,256 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Alfredo Mazzinghi
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+#include <algorithm>
+#include <format>
+#include <string_view>
+
+#include <QDebug>
+
+#include "layout_compare.hh"
+
+namespace cheri {
+
+std::vector<LayoutDelta> LayoutComparator::compare() {
+  base_.loadLayouts();
+  other_.loadLayouts();
+
+  // Hash join on the source identity
+  std::vector<std::pair<SnapshotLayout *, SnapshotLayout *>> changed;
+  std::unordered_set<int64_t> base_owners;
+  std::unordered_set<int64_t> other_owners;
+  unmatched_ = 0;
+  for (auto &layout : base_.layouts()) {
+    auto *match = other_.find(layout.sourceId());
+    if (match == nullptr) {
+      unmatched_++;
+      continue;
+    }
+    if (layout.size == match->size &&
+        layout.total_padding == match->total_padding) {
+      continue;
+    }
+    changed.emplace_back(&layout, match);
+    base_owners.insert(layout.id);
+    other_owners.insert(match->id);
+  }
+  qDebug() << "Found" << changed.size() << "changed layouts," << unmatched_
+           << "unmatched";
+
+  if (changed.empty())
+    return {};
+  base_.loadMembers(base_owners);
+  other_.loadMembers(other_owners);
+
+  std::vector<LayoutDelta> deltas;
+  deltas.reserve(changed.size());
+  for (auto [base_layout, other_layout] : changed) {
+    LayoutDelta delta;
+    delta.id = base_layout->sourceId();
+    delta.base_size = base_layout->size;
+    delta.other_size = other_layout->size;
+    delta.size_delta = static_cast<long long>(other_layout->size) -
+                       static_cast<long long>(base_layout->size);
+    delta.padding_delta = static_cast<long long>(other_layout->total_padding) -
+                          static_cast<long long>(base_layout->total_padding);
+
+    std::unordered_map<std::string_view, const SnapshotMember *> base_members;
+    for (auto &m : base_layout->members)
+      base_members.emplace(m.name, &m);
+
+    for (auto &m : other_layout->members) {
+      auto it = base_members.find(m.name);
+      if (it == base_members.end()) {
+        MemberDelta md;
+        md.name = m.name;
+        md.other_size = m.byte_size;
+        md.is_pointer = m.is_pointer;
+        delta.members.emplace_back(std::move(md));
+        continue;
+      }
+      const SnapshotMember *base_m = it->second;
+      base_members.erase(it);
+      if (base_m->byte_size != m.byte_size) {
+        MemberDelta md;
+        md.name = m.name;
+        md.base_size = base_m->byte_size;
+        md.other_size = m.byte_size;
+        md.is_pointer = m.is_pointer || base_m->is_pointer;
+        delta.members.emplace_back(std::move(md));
+      }
+    }
+    // Remaining members only exist in the base layout
+    for (auto &m : base_layout->members) {
+      if (!base_members.contains(m.name))
+        continue;
+      MemberDelta md;
+      md.name = m.name;
+      md.base_size = m.byte_size;
+      md.is_pointer = m.is_pointer;
+      delta.members.emplace_back(std::move(md));
+    }
+    deltas.emplace_back(std::move(delta));
+  }
+
+  std::sort(deltas.begin(), deltas.end(),
+            [](const LayoutDelta &l, const LayoutDelta &r) {
+              return l.size_delta > r.size_delta;
+            });
+  return deltas;
+}
+
+std::vector<LayoutDiff> LayoutDiffer::diff() {
+  base_.loadLayouts();
+  other_.loadLayouts();
+
+  std::vector<LayoutDiff> diffs;
+  std::vector<std::pair<SnapshotLayout *, SnapshotLayout *>> changed;
+  std::unordered_set<int64_t> base_owners;
+  std::unordered_set<int64_t> other_owners;
+  unchanged_ = 0;
+  for (auto &layout : base_.layouts()) {
+    auto *match = other_.find(layout.sourceId());
+    if (match == nullptr) {
+      diffs.push_back({DiffKind::Removed, layout.sourceId(), {}});
+    } else if (match->fingerprint == layout.fingerprint) {
+      unchanged_++;
+    } else {
+      changed.emplace_back(&layout, match);
+      base_owners.insert(layout.id);
+      other_owners.insert(match->id);
+    }
+  }
+  for (auto &layout : other_.layouts()) {
+    if (base_.find(layout.sourceId()) == nullptr)
+      diffs.push_back({DiffKind::Added, layout.sourceId(), {}});
+  }
+  qDebug() << "Found" << changed.size() << "changed layouts," << unchanged_
+           << "unchanged";
+
+  if (!changed.empty()) {
+    base_.loadMembers(base_owners);
+    other_.loadMembers(other_owners);
+  }
+
+  for (auto [base_layout, other_layout] : changed) {
+    LayoutDiff layout_diff{DiffKind::Changed, base_layout->sourceId(), {}};
+
+    std::unordered_map<std::string_view, const SnapshotMember *> base_members;
+    for (auto &m : base_layout->members)
+      base_members.emplace(m.name, &m);
+
+    for (auto &m : other_layout->members) {
+      auto it = base_members.find(m.name);
+      if (it == base_members.end()) {
+        layout_diff.members.push_back({DiffKind::Added, std::nullopt, m});
+        continue;
+      }
+      if (!(*it->second == m)) {
+        layout_diff.members.push_back({DiffKind::Changed, *it->second, m});
+      }
+      base_members.erase(it);
+    }
+    for (auto &m : base_layout->members) {
+      if (base_members.contains(m.name))
+        layout_diff.members.push_back({DiffKind::Removed, m, std::nullopt});
+    }
+    diffs.emplace_back(std::move(layout_diff));
+  }
+
+  return diffs;
+}
+
+void writeCompareReport(std::ostream &os,
+                        const std::vector<LayoutDelta> &deltas) {
+  long long total_delta = 0;
+  for (auto &delta : deltas) {
+    auto &[name, file, line] = delta.id;
+    total_delta += delta.size_delta;
+    os << std::format("{} {}:{} size {:#x} -> {:#x} ({:+d}) padding {:+d}\n",
+                      name, file, line, delta.base_size, delta.other_size,
+                      delta.size_delta, delta.padding_delta);
+    for (auto &md : delta.members) {
+      auto fmt_size = [](const std::optional<unsigned long long> &size) {
+        return size ? std::format("{:#x}", *size) : std::string("-");
+      };
+      os << std::format("  {} {} -> {}{}\n", md.name, fmt_size(md.base_size),
+                        fmt_size(md.other_size),
+                        md.is_pointer ? " (pointer)" : "");
+    }
+  }
+  os << std::format("{} layouts changed, total size delta {:+d}\n",
+                    deltas.size(), total_delta);
+}
+
+void writeDiffReport(std::ostream &os, const std::vector<LayoutDiff> &diffs) {
+  auto marker = [](DiffKind kind) {
+    switch (kind) {
+    case DiffKind::Added:
+      return '+';
+    case DiffKind::Removed:
+      return '-';
+    default:
+      return '~';
+    }
+  };
+  auto fmt_member = [](const SnapshotMember &m) {
+    auto line = std::format("{} +{:#x}:{} {} ({:#x}:{})", m.name,
+                            m.byte_offset, m.bit_offset, m.type_name,
+                            m.byte_size, m.bit_size);
+    // Show the other fields compared by SnapshotMember::operator==
+    if (m.array_items)
+      line += std::format(" [{}]", *m.array_items);
+    if (m.depth)
+      line += std::format(" depth={}", m.depth);
+    if (m.is_pointer)
+      line += " pointer";
+    if (m.is_function)
+      line += " function";
+    if (m.is_union)
+      line += " union";
+    return line;
+  };
+
+  for (auto &diff : diffs) {
+    auto &[name, file, line] = diff.id;
+    os << std::format("{} {} {}:{}\n", marker(diff.kind), name, file, line);
+    for (auto &md : diff.members) {
+      os << std::format("  {} ", marker(md.kind));
+      if (md.kind == DiffKind::Added) {
+        os << fmt_member(*md.other) << "\n";
+      } else if (md.kind == DiffKind::Removed) {
+        os << fmt_member(*md.base) << "\n";
+      } else {
+        os << fmt_member(*md.base) << " -> " << fmt_member(*md.other)
+           << "\n";
+      }
+    }
+  }
+}
+
+} /* namespace cheri */
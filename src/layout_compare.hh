@@ -0,0 +1,156 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Alfredo Mazzinghi
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <optional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "layout_snapshot.hh"
+
+namespace cheri {
+
+/**
+ * Difference of a member between two builds.
+ * A member that only exists on one side has no size on the other side.
+ */
+struct MemberDelta {
+  MemberDelta() : is_pointer(false) {}
+
+  std::string name;
+  std::optional<unsigned long long> base_size;
+  std::optional<unsigned long long> other_size;
+  bool is_pointer;
+};
+
+/**
+ * Difference of a layout between two builds of the same sources.
+ */
+struct LayoutDelta {
+  LayoutDelta()
+      : base_size(0), other_size(0), size_delta(0), padding_delta(0) {}
+
+  LayoutSourceId id;
+  unsigned long long base_size;
+  unsigned long long other_size;
+  long long size_delta;
+  long long padding_delta;
+  // Members with a different size, responsible for the size delta
+  std::vector<MemberDelta> members;
+};
+
+/**
+ * Compare the layouts of two builds of the same sources, typically
+ * hybrid and purecap.
+ *
+ * Layouts are matched by (name, file, line) with an in-memory hash join,
+ * members are only loaded for the layouts that changed size or padding.
+ */
+class LayoutComparator {
+public:
+  LayoutComparator(LayoutSnapshot &base, LayoutSnapshot &other)
+      : base_(base), other_(other), unmatched_(0) {}
+
+  /**
+   * Produce the list of changed layouts, sorted by decreasing size delta.
+   */
+  std::vector<LayoutDelta> compare();
+
+  /**
+   * Number of layouts in the base snapshot without a match.
+   */
+  unsigned long unmatched() const { return unmatched_; }
+
+private:
+  LayoutSnapshot &base_;
+  LayoutSnapshot &other_;
+  unsigned long unmatched_;
+};
+
+/**
+ * Write a human-readable comparison report.
+ */
+void writeCompareReport(std::ostream &os, const std::vector<LayoutDelta> &deltas);
+
+enum class DiffKind {
+  Added = 1,
+  Removed = 2,
+  Changed = 3,
+};
+
+/**
+ * Member difference between two snapshots of the same layout.
+ */
+struct MemberDiff {
+  DiffKind kind;
+  std::optional<SnapshotMember> base;
+  std::optional<SnapshotMember> other;
+};
+
+/**
+ * Layout difference between two snapshots.
+ * Members are only set for changed layouts.
+ */
+struct LayoutDiff {
+  DiffKind kind;
+  LayoutSourceId id;
+  std::vector<MemberDiff> members;
+};
+
+/**
+ * Find the layouts that changed between two databases.
+ *
+ * Layouts are first compared by fingerprint, members are only loaded for
+ * the layouts with a different fingerprint.
+ */
+class LayoutDiffer {
+public:
+  LayoutDiffer(LayoutSnapshot &base, LayoutSnapshot &other)
+      : base_(base), other_(other), unchanged_(0) {}
+
+  std::vector<LayoutDiff> diff();
+
+  /**
+   * Number of layouts with the same fingerprint.
+   */
+  unsigned long unchanged() const { return unchanged_; }
+
+private:
+  LayoutSnapshot &base_;
+  LayoutSnapshot &other_;
+  unsigned long unchanged_;
+};
+
+/**
+ * Write a human-readable per-member diff report.
+ */
+void writeDiffReport(std::ostream &os, const std::vector<LayoutDiff> &diffs);
+
+} /* namespace cheri */
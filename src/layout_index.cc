@@ -0,0 +1,175 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Alfredo Mazzinghi
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+#include <algorithm>
+#include <format>
+#include <sstream>
+
+#include <QDebug>
+
+#include "layout_index.hh"
+
+namespace cheri {
+
+MemberIntervals::MemberIntervals(const SnapshotLayout &layout)
+    : layout_(layout) {
+  intervals_.reserve(layout.members.size());
+  for (auto &m : layout.members) {
+    // Bitfields cover the bytes they span
+    uint64_t end = m.byte_offset + m.byte_size;
+    if (m.bit_size != 0)
+      end = m.byte_offset + (m.bit_offset + m.bit_size + 7) / 8;
+    intervals_.push_back({m.byte_offset, end, -1, &m});
+  }
+  // Enclosing members come before the members they contain
+  std::stable_sort(intervals_.begin(), intervals_.end(),
+                   [](const Interval &l, const Interval &r) {
+                     if (l.begin != r.begin)
+                       return l.begin < r.begin;
+                     if (l.member->depth != r.member->depth)
+                       return l.member->depth < r.member->depth;
+                     return l.end > r.end;
+                   });
+
+  std::vector<long> open;
+  for (long idx = 0; idx < static_cast<long>(intervals_.size()); idx++) {
+    auto &cur = intervals_[idx];
+    while (!open.empty()) {
+      auto &top = intervals_[open.back()];
+      if (top.member->depth < cur.member->depth && cur.end <= top.end)
+        break;
+      open.pop_back();
+    }
+    cur.parent = open.empty() ? -1 : open.back();
+    open.push_back(idx);
+  }
+}
+
+const SnapshotMember *MemberIntervals::lookup(uint64_t offset) const {
+  auto it = std::upper_bound(
+      intervals_.begin(), intervals_.end(), offset,
+      [](uint64_t value, const Interval &i) { return value < i.begin; });
+  if (it == intervals_.begin())
+    return nullptr;
+  long idx = std::distance(intervals_.begin(), it) - 1;
+  while (idx >= 0) {
+    auto &interval = intervals_[idx];
+    if (offset < interval.end)
+      return interval.member;
+    idx = interval.parent;
+  }
+  return nullptr;
+}
+
+LayoutIndex::LayoutIndex(LayoutSnapshot &snapshot) {
+  layouts_.reserve(snapshot.layouts().size());
+  for (auto &layout : snapshot.layouts()) {
+    if (by_name_.contains(layout.name)) {
+      qDebug() << "Duplicate layout name" << layout.name.c_str()
+               << "ignored in the index";
+      continue;
+    }
+    by_name_.emplace(layout.name, layouts_.size());
+    layouts_.emplace_back(layout);
+  }
+}
+
+const MemberIntervals *LayoutIndex::find(std::string_view name) const {
+  if (auto it = by_name_.find(name); it != by_name_.end())
+    return &layouts_[it->second];
+  return nullptr;
+}
+
+void LayoutIndex::annotate(std::vector<AnnotatedRecord> &batch) const {
+  // Traces tend to repeat the same type, avoid hashing it every time
+  const MemberIntervals *last = nullptr;
+  std::string_view last_type;
+  bool has_last = false;
+  for (auto &record : batch) {
+    if (!has_last || record.type != last_type) {
+      last = find(record.type);
+      last_type = record.type;
+      has_last = true;
+    }
+    record.layout = last ? &last->layout() : nullptr;
+    record.member = last ? last->lookup(record.offset) : nullptr;
+  }
+}
+
+unsigned long long annotateRecords(std::istream &is, std::ostream &os,
+                                   const LayoutIndex &index,
+                                   size_t batch_size) {
+  unsigned long long count = 0;
+  std::vector<AnnotatedRecord> batch;
+  batch.reserve(batch_size);
+
+  auto flush = [&]() {
+    index.annotate(batch);
+    for (auto &record : batch) {
+      if (record.member) {
+        os << std::format("{} {:#x} {} {} {}\n", record.type, record.offset,
+                          record.member->name, record.member->depth,
+                          record.member->is_imprecise ? 1 : 0);
+      } else {
+        os << std::format("{} {:#x} {} - -\n", record.type, record.offset,
+                          record.layout ? "-" : "?");
+      }
+    }
+    count += batch.size();
+    batch.clear();
+  };
+
+  std::string line;
+  std::string offset_field;
+  unsigned long lineno = 0;
+  while (std::getline(is, line)) {
+    lineno++;
+    std::istringstream fields(line);
+    AnnotatedRecord record;
+    if (!(fields >> record.type))
+      continue;
+    size_t end = 0;
+    try {
+      if (fields >> offset_field)
+        record.offset = std::stoull(offset_field, &end, /*base=*/0);
+    } catch (const std::logic_error &) {
+      end = 0;
+    }
+    if (end == 0 || end != offset_field.size()) {
+      qWarning() << "Skip malformed trace record at line" << lineno;
+      continue;
+    }
+    batch.emplace_back(std::move(record));
+    if (batch.size() >= batch_size)
+      flush();
+  }
+  flush();
+  return count;
+}
+
+} /* namespace cheri */
@@ -0,0 +1,129 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Alfredo Mazzinghi
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "layout_snapshot.hh"
+
+namespace cheri {
+
+/**
+ * Interval index over the flattened members of a layout.
+ *
+ * The members are sorted by offset and each member links to the innermost
+ * member that encloses it, so that a lookup is a binary search followed by
+ * a walk towards the top-level members.
+ */
+class MemberIntervals {
+public:
+  MemberIntervals(const SnapshotLayout &layout);
+
+  /**
+   * Find the innermost member that covers the given offset.
+   * Returns nullptr if the offset falls in padding or outside the layout.
+   * For overlapping union members, the enclosing member may be returned
+   * instead of one of the union alternatives.
+   */
+  const SnapshotMember *lookup(uint64_t offset) const;
+
+  const SnapshotLayout &layout() const { return layout_; }
+
+private:
+  struct Interval {
+    uint64_t begin;
+    uint64_t end;
+    // Index of the enclosing interval, or -1 for top-level members
+    long parent;
+    const SnapshotMember *member;
+  };
+
+  const SnapshotLayout &layout_;
+  std::vector<Interval> intervals_;
+};
+
+/**
+ * Annotated trace record.
+ */
+struct AnnotatedRecord {
+  AnnotatedRecord() : offset(0), layout(nullptr), member(nullptr) {}
+
+  std::string type;
+  uint64_t offset;
+  // Layout matching the type name, nullptr if unknown
+  const SnapshotLayout *layout;
+  // Member at the offset, nullptr if unknown or padding
+  const SnapshotMember *member;
+};
+
+/**
+ * Index from layout name to the member intervals of the layout.
+ * The snapshot layouts and members must be loaded and outlive the index.
+ * If multiple layouts share the same name, the first one is used.
+ */
+class LayoutIndex {
+public:
+  LayoutIndex(LayoutSnapshot &snapshot);
+
+  /**
+   * Find the intervals for a layout name, returns nullptr if not found.
+   */
+  const MemberIntervals *find(std::string_view name) const;
+
+  /**
+   * Fill the layout and member of a batch of records.
+   */
+  void annotate(std::vector<AnnotatedRecord> &batch) const;
+
+  size_t size() const { return by_name_.size(); }
+
+private:
+  std::vector<MemberIntervals> layouts_;
+  std::unordered_map<std::string_view, size_t> by_name_;
+};
+
+/**
+ * Annotate a stream of "TYPE OFFSET" records, one per line.
+ * Offsets may be decimal or 0x-prefixed hex. Each record is written back
+ * with the member name, nesting depth and imprecision, or '-' when there
+ * is no member at the offset.
+ * Records are processed in batches of the given size.
+ * Returns the number of records annotated.
+ */
+unsigned long long annotateRecords(std::istream &is, std::ostream &os,
+                                   const LayoutIndex &index,
+                                   size_t batch_size);
+
+} /* namespace cheri */
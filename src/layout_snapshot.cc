@@ -0,0 +1,203 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Alfredo Mazzinghi
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+#include <algorithm>
+#include <atomic>
+#include <format>
+#include <stdexcept>
+
+#include <QDebug>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QVariant>
+
+#include <llvm/ADT/Hashing.h>
+
+#include "layout_snapshot.hh"
+#include "storage.hh"
+#include "utils.hh"
+
+namespace fs = std::filesystem;
+
+namespace cheri {
+
+std::size_t
+LayoutSourceHash::operator()(const LayoutSourceId &k) const noexcept {
+  std::size_t h0 = std::hash<std::string>{}(std::get<0>(k));
+  std::size_t h1 = std::hash<std::string>{}(std::get<1>(k));
+  std::size_t h2 = std::hash<unsigned long long>{}(std::get<2>(k));
+
+  return llvm::hash_combine(h0, h1, h2);
+}
+
+LayoutSnapshot::LayoutSnapshot(fs::path db_path) : db_path_(db_path) {
+  static std::atomic<unsigned long> next_conn = 0;
+  conn_name_ = QString::fromStdString(
+      std::format("snapshot-{}", next_conn.fetch_add(1)));
+
+  if (!fs::exists(db_path)) {
+    qCritical() << "Database" << db_path << "does not exist";
+    throw std::runtime_error("Missing database " + db_path.string());
+  }
+  db_ = QSqlDatabase::addDatabase("QSQLITE", conn_name_);
+  db_.setDatabaseName(QString::fromStdString(db_path));
+  db_.setConnectOptions("QSQLITE_OPEN_READONLY");
+  if (!db_.open()) {
+    qCritical() << "Failed to open database" << db_path
+                << "reason:" << db_.lastError();
+    throw DBError(db_.lastError());
+  }
+}
+
+LayoutSnapshot::~LayoutSnapshot() {
+  db_.close();
+  db_ = QSqlDatabase();
+  QSqlDatabase::removeDatabase(conn_name_);
+}
+
+void LayoutSnapshot::loadLayouts() {
+  QSqlQuery q(db_);
+  q.setForwardOnly(true);
+  if (!q.exec("SELECT id, name, file, line, size, total_padding, "
+              "fingerprint FROM type_layout ORDER BY id")) {
+    qCritical() << "Failed to load layouts from" << db_path_
+                << "reason:" << q.lastError().text();
+    throw DBError(q.lastError());
+  }
+
+  while (q.next()) {
+    SnapshotLayout layout;
+    layout.id = q.value(0).toLongLong();
+    layout.name = q.value(1).toString().toStdString();
+    layout.file = q.value(2).toString().toStdString();
+    layout.line = q.value(3).toULongLong();
+    layout.size = q.value(4).toULongLong();
+    layout.total_padding = q.value(5).toULongLong();
+    layout.fingerprint = q.value(6).toString().toStdString();
+
+    auto [pos, inserted] =
+        by_source_.emplace(layout.sourceId(), layouts_.size());
+    if (!inserted)
+      continue;
+    by_id_.emplace(layout.id, layouts_.size());
+    layouts_.emplace_back(std::move(layout));
+  }
+  qDebug() << "Loaded" << layouts_.size() << "layouts from" << db_path_;
+}
+
+void LayoutSnapshot::loadMembers(const std::unordered_set<int64_t> &owners) {
+  // Member IDs follow the flattening order
+  const QString select = "SELECT owner, id, name, type_name, byte_size, "
+                         "bit_size, byte_offset, bit_offset, is_pointer, "
+                         "is_imprecise, required_align, padded_size, "
+                         "array_items, is_function, is_union, depth "
+                         "FROM layout_member ";
+  const QString order = " ORDER BY owner, id";
+
+  if (owners.empty()) {
+    QSqlQuery q(db_);
+    q.setForwardOnly(true);
+    if (!q.exec(select + order)) {
+      qCritical() << "Failed to load layout members from" << db_path_
+                  << "reason:" << q.lastError().text();
+      throw DBError(q.lastError());
+    }
+    loadMemberRows(q);
+    return;
+  }
+
+  // Filter the owners in the query, in chunks that stay below the
+  // SQLite limit on the number of bound parameters.
+  std::vector<int64_t> sorted(owners.begin(), owners.end());
+  std::sort(sorted.begin(), sorted.end());
+  constexpr std::size_t kChunkSize = 500;
+  for (std::size_t base = 0; base < sorted.size(); base += kChunkSize) {
+    auto count = std::min(kChunkSize, sorted.size() - base);
+    QString params = "?";
+    for (std::size_t i = 1; i < count; i++)
+      params += ",?";
+
+    QSqlQuery q(db_);
+    q.setForwardOnly(true);
+    q.prepare(select + "WHERE owner IN (" + params + ")" + order);
+    for (std::size_t i = 0; i < count; i++)
+      q.addBindValue(static_cast<qlonglong>(sorted[base + i]));
+    if (!q.exec()) {
+      qCritical() << "Failed to load layout members from" << db_path_
+                  << "reason:" << q.lastError().text();
+      throw DBError(q.lastError());
+    }
+    loadMemberRows(q);
+  }
+}
+
+void LayoutSnapshot::loadMemberRows(QSqlQuery &q) {
+  SnapshotLayout *layout = nullptr;
+  while (q.next()) {
+    int64_t owner = q.value(0).toLongLong();
+    if (layout == nullptr || layout->id != owner) {
+      layout = findById(owner);
+      if (layout == nullptr)
+        continue;
+      layout->members.clear();
+    }
+
+    SnapshotMember m;
+    m.id = q.value(1).toLongLong();
+    m.name = q.value(2).toString().toStdString();
+    m.type_name = q.value(3).toString().toStdString();
+    m.byte_size = q.value(4).toULongLong();
+    m.bit_size = q.value(5).toULongLong();
+    m.byte_offset = q.value(6).toULongLong();
+    m.bit_offset = q.value(7).toULongLong();
+    m.is_pointer = q.value(8).toBool();
+    m.is_imprecise = q.value(9).toBool();
+    m.required_align = q.value(10).toULongLong();
+    m.padded_size = q.value(11).toULongLong();
+    if (!q.value(12).isNull())
+      m.array_items = q.value(12).toULongLong();
+    m.is_function = q.value(13).toBool();
+    m.is_union = q.value(14).toBool();
+    m.depth = q.value(15).toULongLong();
+    layout->members.emplace_back(std::move(m));
+  }
+}
+
+SnapshotLayout *LayoutSnapshot::find(const LayoutSourceId &id) {
+  if (auto it = by_source_.find(id); it != by_source_.end())
+    return &layouts_[it->second];
+  return nullptr;
+}
+
+SnapshotLayout *LayoutSnapshot::findById(int64_t id) {
+  if (auto it = by_id_.find(id); it != by_id_.end())
+    return &layouts_[it->second];
+  return nullptr;
+}
+
+} /* namespace cheri */
@@ -0,0 +1,170 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Alfredo Mazzinghi
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <QSqlDatabase>
+#include <QSqlQuery>
+
+namespace cheri {
+
+/**
+ * Source identity of a layout, independent of the binary and database.
+ * This is the (name, file, line) tuple.
+ */
+using LayoutSourceId = std::tuple<std::string, std::string, unsigned long long>;
+
+struct LayoutSourceHash {
+  std::size_t operator()(const LayoutSourceId &k) const noexcept;
+};
+
+/**
+ * Read-only copy of a layout_member row.
+ */
+struct SnapshotMember {
+  SnapshotMember()
+      : id(0), byte_size(0), bit_size(0), byte_offset(0), bit_offset(0),
+        depth(0), required_align(0), padded_size(0), is_pointer(false),
+        is_function(false), is_union(false), is_imprecise(false) {}
+
+  /**
+   * Compare the fields hashed in the type_layout fingerprint, so that
+   * layouts with different fingerprints have a member that differs.
+   */
+  bool operator==(const SnapshotMember &other) const {
+    return name == other.name && type_name == other.type_name &&
+           byte_size == other.byte_size && bit_size == other.bit_size &&
+           byte_offset == other.byte_offset &&
+           bit_offset == other.bit_offset &&
+           array_items == other.array_items && depth == other.depth &&
+           is_pointer == other.is_pointer &&
+           is_function == other.is_function && is_union == other.is_union;
+  }
+
+  int64_t id;
+  std::string name;
+  std::string type_name;
+  unsigned long long byte_size;
+  unsigned long long bit_size;
+  unsigned long long byte_offset;
+  unsigned long long bit_offset;
+  std::optional<unsigned long long> array_items;
+  // Nesting depth, 0 for the direct members of the layout
+  unsigned long depth;
+  // Minimum alignment and padded length required for exact bounds
+  unsigned long long required_align;
+  unsigned long long padded_size;
+  bool is_pointer;
+  bool is_function;
+  bool is_union;
+  bool is_imprecise;
+};
+
+/**
+ * Read-only copy of a type_layout row and, optionally, its members.
+ */
+struct SnapshotLayout {
+  SnapshotLayout() : id(0), line(0), size(0), total_padding(0) {}
+  LayoutSourceId sourceId() const { return std::make_tuple(name, file, line); }
+
+  int64_t id;
+  std::string name;
+  std::string file;
+  unsigned long long line;
+  unsigned long long size;
+  unsigned long long total_padding;
+  std::string fingerprint;
+  // Members sorted by flattening order, only filled by loadMembers()
+  std::vector<SnapshotMember> members;
+};
+
+/**
+ * In-memory snapshot of the layouts stored in a database produced by
+ * the flat-layout scraper.
+ *
+ * This is used by the offline analyses that operate on one or more existing
+ * databases, and uses a private connection instead of the StorageManager
+ * per-thread connections, so that multiple databases can be open at once.
+ */
+class LayoutSnapshot {
+public:
+  LayoutSnapshot(std::filesystem::path db_path);
+  LayoutSnapshot(const LayoutSnapshot &other) = delete;
+  ~LayoutSnapshot();
+
+  /**
+   * Load all the type_layout rows.
+   * Layouts that share the same source identity across binaries are loaded
+   * once, using the first row found.
+   */
+  void loadLayouts();
+
+  /**
+   * Load the members of the given layouts, or all layouts if owners is empty.
+   */
+  void loadMembers(const std::unordered_set<int64_t> &owners = {});
+
+  std::vector<SnapshotLayout> &layouts() { return layouts_; }
+
+  /**
+   * Find a layout by source identity, returns nullptr if not found.
+   */
+  SnapshotLayout *find(const LayoutSourceId &id);
+
+  /**
+   * Find a layout by database ID, returns nullptr if not found.
+   */
+  SnapshotLayout *findById(int64_t id);
+
+  QSqlDatabase &database() { return db_; }
+
+private:
+  /**
+   * Append the members returned by a layout_member query, ordered by owner.
+   */
+  void loadMemberRows(QSqlQuery &q);
+
+  std::filesystem::path db_path_;
+  QString conn_name_;
+  QSqlDatabase db_;
+  std::vector<SnapshotLayout> layouts_;
+  std::unordered_map<LayoutSourceId, size_t, LayoutSourceHash> by_source_;
+  std::unordered_map<int64_t, size_t> by_id_;
+};
+
+} /* namespace cheri */
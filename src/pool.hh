@@ -30,12 +30,15 @@
 #include <concepts>
 #include <filesystem>
 #include <future>
+#include <memory>
 
 #include <QDebug>
 #include <QThreadPool>
 #include <QtLogging>
 
+#include "progress.hh"
 #include "scraper.hh"
+#include "trace.hh"
 
 namespace cheri {
 
@@ -50,15 +53,29 @@ public:
     pool_.setMaxThreadCount(workers);
   }
 
+  /**
+   * Count the scheduled and completed jobs in the given progress counters.
+   */
+  void setProgress(std::shared_ptr<ProgressCounters> progress) {
+    progress_ = std::move(progress);
+  }
+
   std::future<ScraperResult> schedule(std::unique_ptr<DwarfScraper> scraper) {
     std::promise<ScraperResult> promise;
     auto result = promise.get_future();
     auto token = stop_state_.get_token();
+    if (progress_) {
+      progress_->jobs_total.fetch_add(1, std::memory_order_relaxed);
+    }
 
-    pool_.start([s = std::move(scraper), p = std::move(promise),
-                 token]() mutable {
+    pool_.start([s = std::move(scraper), p = std::move(promise), token,
+                 progress = progress_]() mutable {
+      Tracer::nameThread("worker");
+      TraceScope span("job", s->source().getPath().string());
       try {
-        s->initSchema();
+        if (!s->isDryRun()) {
+          s->initSchema();
+        }
         qInfo() << "Begin scraper" << s->name() << "job for"
                 << s->source().getPath().string();
         s->run(token);
@@ -70,6 +87,9 @@ public:
                     << s->source().getPath().string() << "reason " << ex.what();
         p.set_exception(std::current_exception());
       }
+      if (progress) {
+        progress->jobs_done.fetch_add(1, std::memory_order_relaxed);
+      }
     });
     return result;
   }
@@ -84,6 +104,7 @@ public:
 private:
   std::stop_source stop_state_;
   QThreadPool pool_;
+  std::shared_ptr<ProgressCounters> progress_;
 };
 
 } /* namespace cheri */
@@ -0,0 +1,154 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Alfredo Mazzinghi
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+#include <algorithm>
+#include <format>
+#include <fstream>
+
+#include <QDebug>
+
+#include "progress.hh"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+std::string formatDuration(std::chrono::duration<double> duration) {
+  auto secs = static_cast<unsigned long long>(duration.count());
+  if (secs >= 3600)
+    return std::format("{}h{:02}m{:02}s", secs / 3600, (secs / 60) % 60,
+                       secs % 60);
+  if (secs >= 60)
+    return std::format("{}m{:02}s", secs / 60, secs % 60);
+  return std::format("{}s", secs);
+}
+
+} // namespace
+
+namespace cheri {
+
+ProgressSample::ProgressSample(const ProgressCounters &counters,
+                               std::chrono::duration<double> elapsed,
+                               unsigned long queue_depth)
+    : elapsed(elapsed),
+      jobs_total(counters.jobs_total.load(std::memory_order_relaxed)),
+      jobs_started(counters.jobs_started.load(std::memory_order_relaxed)),
+      jobs_done(counters.jobs_done.load(std::memory_order_relaxed)),
+      units_total(counters.units_total.load(std::memory_order_relaxed)),
+      units(counters.units.load(std::memory_order_relaxed)),
+      dies(counters.dies.load(std::memory_order_relaxed)),
+      layouts(counters.layouts.load(std::memory_order_relaxed)),
+      queue_depth(queue_depth) {}
+
+std::optional<std::chrono::duration<double>> ProgressSample::remaining() const {
+  if (jobs_total > 0 && jobs_done >= jobs_total)
+    return std::chrono::duration<double>(0);
+  if (jobs_started == 0 || units == 0)
+    return std::nullopt;
+
+  double total = static_cast<double>(units_total) * jobs_total / jobs_started;
+  double fraction = std::min(units / total, 1.0);
+  return elapsed * (1 - fraction) / fraction;
+}
+
+std::string formatProgress(const ProgressSample &prev,
+                           const ProgressSample &cur) {
+  double dt = (cur.elapsed - prev.elapsed).count();
+  auto rate = [dt](unsigned long long before, unsigned long long after) {
+    return dt > 0 ? (after - before) / dt : 0.0;
+  };
+
+  auto line = std::format(
+      "progress: jobs {}/{} units {}/{} ({:.1f}/s) dies {} ({:.1f}/s) "
+      "layouts {} ({:.1f}/s) db queue {} elapsed {}",
+      cur.jobs_done, cur.jobs_total, cur.units, cur.units_total,
+      rate(prev.units, cur.units), cur.dies, rate(prev.dies, cur.dies),
+      cur.layouts, rate(prev.layouts, cur.layouts), cur.queue_depth,
+      formatDuration(cur.elapsed));
+  if (auto eta = cur.remaining()) {
+    line += std::format(" eta {}", formatDuration(*eta));
+  }
+  return line;
+}
+
+ProgressReporter::ProgressReporter(
+    std::shared_ptr<const ProgressCounters> counters, const StorageManager &sm,
+    std::chrono::seconds interval, std::optional<fs::path> status_file)
+    : counters_(std::move(counters)), sm_(sm), interval_(interval),
+      status_file_(std::move(status_file)), start_(Clock::now()),
+      thread_([this](std::stop_token stop_tok) { run(stop_tok); }) {}
+
+ProgressReporter::~ProgressReporter() {
+  thread_.request_stop();
+  thread_.join();
+}
+
+ProgressSample ProgressReporter::sample() const {
+  return ProgressSample(*counters_, Clock::now() - start_, sm_.queueDepth());
+}
+
+void ProgressReporter::run(std::stop_token stop_tok) {
+  ProgressSample prev;
+  std::unique_lock lock(mutex_);
+  while (!stop_tok.stop_requested()) {
+    wakeup_.wait_for(lock, stop_tok, interval_, [] { return false; });
+    auto cur = sample();
+    report(prev, cur);
+    prev = cur;
+  }
+}
+
+void ProgressReporter::report(const ProgressSample &prev,
+                              const ProgressSample &cur) {
+  auto line = formatProgress(prev, cur);
+  if (!status_file_) {
+    qInfo().noquote() << QString::fromStdString(line);
+    return;
+  }
+
+  // Replace the status file atomically, so that readers never see a
+  // partial line.
+  auto tmp_path = *status_file_;
+  tmp_path += ".tmp";
+  {
+    std::ofstream status(tmp_path, std::ios::out | std::ios::trunc);
+    if (!status) {
+      qWarning() << "Can not write status file" << tmp_path.string();
+      return;
+    }
+    status << line << std::endl;
+  }
+  std::error_code ec;
+  fs::rename(tmp_path, *status_file_, ec);
+  if (ec) {
+    qWarning() << "Can not update status file" << status_file_->string()
+               << ec.message();
+  }
+}
+
+} /* namespace cheri */
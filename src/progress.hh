@@ -0,0 +1,136 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Alfredo Mazzinghi
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <thread>
+
+#include "storage.hh"
+
+namespace cheri {
+
+/**
+ * Progress counters shared by all the scraper jobs.
+ * The workers only update these once per compilation unit or database
+ * record, with relaxed atomics, so that the hot paths are not affected.
+ */
+struct ProgressCounters {
+  ProgressCounters()
+      : jobs_total(0), jobs_started(0), jobs_done(0), units_total(0),
+        units(0), dies(0), layouts(0) {}
+
+  std::atomic<unsigned long> jobs_total;
+  std::atomic<unsigned long> jobs_started;
+  std::atomic<unsigned long> jobs_done;
+  // Compilation units in the jobs that started so far
+  std::atomic<unsigned long long> units_total;
+  std::atomic<unsigned long long> units;
+  // DIEs in the scanned units
+  std::atomic<unsigned long long> dies;
+  // Layouts written to the database
+  std::atomic<unsigned long long> layouts;
+};
+
+/**
+ * Point-in-time copy of the progress counters.
+ */
+struct ProgressSample {
+  ProgressSample()
+      : elapsed(0), jobs_total(0), jobs_started(0), jobs_done(0),
+        units_total(0), units(0), dies(0), layouts(0), queue_depth(0) {}
+  ProgressSample(const ProgressCounters &counters,
+                 std::chrono::duration<double> elapsed,
+                 unsigned long queue_depth);
+
+  /**
+   * Estimated time to completion, if any progress was made.
+   * The units of the jobs that did not start yet are extrapolated from the
+   * average number of units in the jobs that did.
+   */
+  std::optional<std::chrono::duration<double>> remaining() const;
+
+  std::chrono::duration<double> elapsed;
+  unsigned long jobs_total;
+  unsigned long jobs_started;
+  unsigned long jobs_done;
+  unsigned long long units_total;
+  unsigned long long units;
+  unsigned long long dies;
+  unsigned long long layouts;
+  // Threads waiting for the database transaction lock
+  unsigned long queue_depth;
+};
+
+/**
+ * Format a progress line, the rates are computed over the interval since
+ * the previous sample.
+ */
+std::string formatProgress(const ProgressSample &prev,
+                           const ProgressSample &cur);
+
+/**
+ * Periodically report the progress counters, either to the log or by
+ * rewriting a status file.
+ * The reporter thread stops, and prints a final report, on destruction.
+ */
+class ProgressReporter {
+  using Clock = std::chrono::steady_clock;
+
+public:
+  ProgressReporter(std::shared_ptr<const ProgressCounters> counters,
+                   const StorageManager &sm, std::chrono::seconds interval,
+                   std::optional<std::filesystem::path> status_file);
+  ProgressReporter(const ProgressReporter &other) = delete;
+  ~ProgressReporter();
+
+private:
+  void run(std::stop_token stop_tok);
+  ProgressSample sample() const;
+  void report(const ProgressSample &prev, const ProgressSample &cur);
+
+  std::shared_ptr<const ProgressCounters> counters_;
+  const StorageManager &sm_;
+  std::chrono::seconds interval_;
+  std::optional<std::filesystem::path> status_file_;
+  Clock::time_point start_;
+  std::mutex mutex_;
+  std::condition_variable_any wakeup_;
+  // Must be last, so that the thread is joined before the members go away
+  std::jthread thread_;
+};
+
+} /* namespace cheri */
@@ -0,0 +1,178 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Alfredo Mazzinghi
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+#include <chrono>
+#include <cmath>
+#include <map>
+#include <string_view>
+
+#include <QJsonArray>
+#include <QJsonDocument>
+
+#include "run_report.hh"
+
+namespace {
+
+/*
+ * Items per second of a profile phase, rounded to an integer so that the
+ * report can be compared without floating point support.
+ */
+qint64 throughput(const cheri::ScraperResult &result, std::string_view phase,
+                  unsigned long long items) {
+  auto it = result.profile.find(phase);
+  if (it == result.profile.end() || it->second.total.count() == 0)
+    return 0;
+  std::chrono::duration<double> seconds = it->second.total;
+  return std::llround(items / seconds.count());
+}
+
+} // namespace
+
+namespace cheri {
+
+QJsonObject resultToJson(const ScraperResult &result) {
+  QJsonObject obj;
+  auto counter = [&obj](const char *name, unsigned long long value) {
+    obj[name] = static_cast<qint64>(value);
+  };
+  counter("units", result.units);
+  counter("dies", result.dies);
+  counter("layouts", result.layouts);
+  counter("members", result.members);
+  counter("imprecise_members", result.imprecise_members);
+  counter("total_padding", result.total_padding);
+  counter("globals", result.globals);
+  counter("imprecise_globals", result.imprecise_globals);
+  counter("frames", result.frames);
+  counter("locals", result.locals);
+  counter("imprecise_locals", result.imprecise_locals);
+  counter("dup_structs", result.dup_structs);
+  counter("dup_members", result.dup_members);
+  obj["scraper"] = QString::fromStdString(result.scraper);
+
+  QJsonArray errors;
+  for (auto &error : result.errors)
+    errors.append(QString::fromStdString(error));
+  obj["errors"] = errors;
+
+  QJsonObject memory;
+  memory["mapped_bytes"] = static_cast<qint64>(result.memory.mapped_bytes);
+  memory["die_bytes"] = static_cast<qint64>(result.memory.die_bytes);
+  memory["state_peak_bytes"] =
+      static_cast<qint64>(result.memory.state_peak_bytes);
+  obj["memory"] = memory;
+
+  QJsonObject timings;
+  for (auto &[name, info] : result.profile) {
+    std::chrono::duration<double, std::milli> ms = info.total;
+    QJsonObject phase;
+    phase["total_ms"] = ms.count();
+    phase["count"] = static_cast<qint64>(info.count);
+    timings[QString::fromStdString(name)] = phase;
+  }
+  obj["timings"] = timings;
+
+  // Storage distributions, latencies in microseconds
+  auto histogram = [](const Histogram &h, double scale) {
+    QJsonObject dist;
+    dist["count"] = static_cast<qint64>(h.count());
+    dist["p50"] = h.percentile(50) / scale;
+    dist["p99"] = h.percentile(99) / scale;
+    dist["max"] = h.max() / scale;
+    return dist;
+  };
+  QJsonObject storage;
+  storage["lock_wait_us"] = histogram(result.storage.lock_wait, 1000);
+  storage["transaction_us"] = histogram(result.storage.transaction, 1000);
+  storage["commit_us"] = histogram(result.storage.commit, 1000);
+  storage["query_us"] = histogram(result.storage.statement, 1000);
+  storage["rows_per_transaction"] = histogram(result.storage.rows, 1);
+  obj["storage"] = storage;
+
+  // Throughput per second of job time, this does not depend on the
+  // number of worker threads.
+  QJsonObject rates;
+  rates["dies_per_s"] = throughput(result, "elapsed_time", result.dies);
+  rates["layouts_per_s"] = throughput(result, "elapsed_time", result.layouts);
+  rates["members_per_s"] = throughput(result, "elapsed_time", result.members);
+  rates["inserts_per_s"] = throughput(result, "db_transaction",
+                                      result.layouts + result.members);
+  obj["throughput"] = rates;
+
+  return obj;
+}
+
+void writeRunReport(std::ostream &os, const std::vector<ScraperResult> &results,
+                    const std::vector<FailedJob> &failed) {
+  struct BinaryEntry {
+    ScraperResult merged;
+    unsigned long jobs = 0;
+    std::vector<std::string> errors;
+  };
+
+  // Merge the jobs by binary, sorted by path for a stable output
+  std::map<std::filesystem::path, BinaryEntry> binaries;
+  ScraperResult total;
+  for (auto &result : results) {
+    auto &entry = binaries[result.source];
+    entry.merged.merge(result);
+    entry.jobs++;
+    total.merge(result);
+  }
+  for (auto &job : failed) {
+    binaries[job.source].errors.push_back(job.error);
+  }
+
+  QJsonArray binaries_json;
+  for (auto &[path, entry] : binaries) {
+    auto obj = resultToJson(entry.merged);
+    obj["binary"] = QString::fromStdString(path.string());
+    obj["jobs"] = static_cast<qint64>(entry.jobs);
+    obj["failed"] = !entry.errors.empty();
+    if (!entry.errors.empty()) {
+      // The shards of a binary usually fail for the same reason
+      obj["failed_jobs"] = static_cast<qint64>(entry.errors.size());
+      obj["error"] = QString::fromStdString(entry.errors.front());
+    }
+    binaries_json.append(obj);
+  }
+
+  auto totals = resultToJson(total);
+  totals["binaries"] = static_cast<qint64>(binaries.size());
+  totals["jobs"] = static_cast<qint64>(results.size());
+  totals["failed_jobs"] = static_cast<qint64>(failed.size());
+
+  QJsonObject report;
+  report["binaries"] = binaries_json;
+  report["totals"] = totals;
+  report["peak_rss_bytes"] = static_cast<qint64>(peakResidentBytes());
+
+  os << QJsonDocument(report).toJson().toStdString();
+}
+
+} /* namespace cheri */
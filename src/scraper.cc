@@ -25,13 +25,17 @@
  * SUCH DAMAGE.
  */
 
+#include <algorithm>
 #include <bit>
 #include <cassert>
 #include <format>
 #include <limits>
+#include <map>
 #include <mutex>
 #include <stdexcept>
 
+#include <sys/resource.h>
+
 #include <llvm/DebugInfo/DIContext.h>
 #include <llvm/MC/TargetRegistry.h>
 #include <llvm/Object/ObjectFile.h>
@@ -39,11 +43,13 @@
 #include <llvm/Support/raw_ostream.h>
 
 #include <QDebug>
+#include <QVariant>
 #include <QtLogging>
 
 #include "cheri_compressed_cap.h"
 
 #include "scraper.hh"
+#include "trace.hh"
 
 namespace fs = std::filesystem;
 namespace object = llvm::object;
@@ -104,6 +110,13 @@ template <typename CC> uint64_t findRepresentableAlignImpl(uint64_t length) {
   return CC::representable_mask(length);
 }
 
+template <typename CC>
+std::pair<uint64_t, uint64_t> findRepresentablePaddingImpl(uint64_t length) {
+  auto [_, padded_length] = findRepresentableRangeImpl<CC>(0, length);
+  uint64_t align_mask = findRepresentableAlignImpl<CC>(padded_length);
+  return std::make_pair(~align_mask + 1, padded_length);
+}
+
 template <typename CC> uint64_t findMaxRepresentableLengthImpl(uint64_t base) {
   /*
    * A length becomes (possibly) not representable when L >= 2^{MW - 2}.
@@ -151,9 +164,101 @@ QDebug operator<<(QDebug debug, const ScraperResult &sr) {
   if (sr.errors.size()) {
     stream << " (WITH ERRORS)";
   }
+  if (sr.units) {
+    stream << " " << sr.units << " units, " << sr.dies << " DIEs";
+  }
+  if (sr.dup_structs || sr.dup_members) {
+    stream << " " << sr.dup_structs << " duplicate layouts, "
+           << sr.dup_members << " duplicate members";
+  }
+  if (sr.layouts) {
+    stream << " " << sr.layouts << " layouts, " << sr.members << " members, "
+           << sr.imprecise_members << " imprecise, " << sr.total_padding
+           << " padding bytes";
+  }
+  if (sr.globals) {
+    stream << " " << sr.globals << " globals, " << sr.imprecise_globals
+           << " imprecise";
+  }
+  if (sr.frames) {
+    stream << " " << sr.frames << " frames, " << sr.locals << " locals, "
+           << sr.imprecise_locals << " imprecise";
+  }
+  if (sr.memory.total()) {
+    constexpr double kMiB = 1024 * 1024;
+    stream << " "
+           << std::format("memory: mapped={:.1f}MiB dies={:.1f}MiB "
+                          "state={:.1f}MiB",
+                          sr.memory.mapped_bytes / kMiB,
+                          sr.memory.die_bytes / kMiB,
+                          sr.memory.state_peak_bytes / kMiB)
+                  .c_str();
+  }
+  if (!sr.profile.empty()) {
+    // Sort the phases for a stable output
+    std::map<std::string_view, const TimingInfo *> phases;
+    for (auto &[name, info] : sr.profile)
+      phases.emplace(name, &info);
+    stream << " time:";
+    for (auto &[name, info] : phases) {
+      std::chrono::duration<double, std::milli> ms = info->total;
+      stream << " "
+             << std::format("{}={:.3f}ms/{}", name, ms.count(), info->count)
+                    .c_str();
+    }
+  }
   return debug;
 }
 
+void MemoryInfo::merge(const MemoryInfo &other) {
+  mapped_bytes += other.mapped_bytes;
+  die_bytes += other.die_bytes;
+  state_peak_bytes = std::max(state_peak_bytes, other.state_peak_bytes);
+}
+
+uint64_t peakResidentBytes() {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+  // The maximum RSS is reported in KiB
+  return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+}
+
+void ScraperResult::merge(const ScraperResult &other) {
+  errors.insert(errors.end(), other.errors.begin(), other.errors.end());
+  memory.merge(other.memory);
+  storage.merge(other.storage);
+  if (scraper.empty())
+    scraper = other.scraper;
+  dup_structs += other.dup_structs;
+  dup_members += other.dup_members;
+  units += other.units;
+  dies += other.dies;
+  layouts += other.layouts;
+  members += other.members;
+  imprecise_members += other.imprecise_members;
+  total_padding += other.total_padding;
+  globals += other.globals;
+  imprecise_globals += other.imprecise_globals;
+  frames += other.frames;
+  locals += other.locals;
+  imprecise_locals += other.imprecise_locals;
+  for (auto &[name, info] : other.profile)
+    profile[name].merge(info);
+}
+
+TimingScope ScraperResult::Timing(std::string_view name) {
+  return TimingScope(phase(name));
+}
+
+TimingInfo &ScraperResult::phase(std::string_view name) {
+  auto it = profile.find(name);
+  if (it == profile.end())
+    it = profile.emplace(std::string(name), TimingInfo()).first;
+  return it->second;
+}
+
 std::string anonymousName(const llvm::DWARFDie &die) {
   return std::format("<anon@{:#x}>", die.getOffset());
 }
@@ -175,19 +280,23 @@ std::optional<std::string> getStrAttr(const llvm::DWARFDie &die,
 }
 
 DwarfSource::DwarfSource(fs::path path) : path_{path} {
+  TraceScope span("load_source", path.string());
   static std::once_flag llvm_init_flag;
   std::call_once(llvm_init_flag, []() {
     llvm::InitializeAllTargetInfos();
     llvm::InitializeAllTargetMCs();
   });
 
-  llvm::Expected<object::OwningBinary<object::Binary>> bin_or_err =
-      object::createBinary(path.string());
-  if (auto err = bin_or_err.takeError()) {
-    throw std::runtime_error(llvm::toString(std::move(err)));
-  }
+  {
+    TimingScope timing(load_timing_);
+    llvm::Expected<object::OwningBinary<object::Binary>> bin_or_err =
+        object::createBinary(path.string());
+    if (auto err = bin_or_err.takeError()) {
+      throw std::runtime_error(llvm::toString(std::move(err)));
+    }
 
-  owned_binary_ = std::move(*bin_or_err);
+    owned_binary_ = std::move(*bin_or_err);
+  }
 
   auto *obj = llvm::dyn_cast<object::ObjectFile>(owned_binary_.getBinary());
   if (obj == nullptr) {
@@ -195,9 +304,12 @@ DwarfSource::DwarfSource(fs::path path) : path_{path} {
         std::format("Invalid binary at %s, not an object", path.string()));
   }
 
-  dictx_ = llvm::DWARFContext::create(
-      *obj, llvm::DWARFContext::ProcessDebugRelocations::Process, nullptr, "",
-      nullptr);
+  {
+    TimingScope timing(context_timing_);
+    dictx_ = llvm::DWARFContext::create(
+        *obj, llvm::DWARFContext::ProcessDebugRelocations::Process, nullptr,
+        "", nullptr);
+  }
 
   // Check DWARF version
   if (dictx_->getMaxVersion() < 4) {
@@ -207,6 +319,10 @@ DwarfSource::DwarfSource(fs::path path) : path_{path} {
 
 fs::path DwarfSource::getPath() const { return path_; }
 
+uint64_t DwarfSource::mappedBytes() const {
+  return owned_binary_.getBinary()->getData().size();
+}
+
 llvm::DWARFContext &DwarfSource::getContext() const { return *dictx_; }
 
 int DwarfSource::getABIPointerSize() const {
@@ -241,6 +357,62 @@ int DwarfSource::getABICapabilitySize() const {
   throw std::runtime_error("Unsupported architecture");
 }
 
+std::vector<SectionInfo> DwarfSource::getDataSections() const {
+  auto *obj = dictx_->getDWARFObj().getFile();
+  assert(obj != nullptr && "Invalid DWARF source");
+  std::vector<SectionInfo> sections;
+
+  for (auto &section : obj->sections()) {
+    if (!section.isData() && !section.isBSS())
+      continue;
+    // Skip non-allocated sections, these have no address
+    if (section.getAddress() == 0)
+      continue;
+    auto name = section.getName();
+    if (!name) {
+      throw ScraperError("Invalid section name:", name);
+    }
+    SectionInfo info;
+    info.name = name->str();
+    info.addr = section.getAddress();
+    info.size = section.getSize();
+    info.is_bss = section.isBSS();
+    sections.push_back(std::move(info));
+  }
+  std::sort(sections.begin(), sections.end(),
+            [](auto &l, auto &r) { return l.addr < r.addr; });
+  return sections;
+}
+
+int DwarfSource::getABIAddressSize() const {
+  auto *obj = dictx_->getDWARFObj().getFile();
+  assert(obj != nullptr && "Invalid DWARF source");
+  auto triple = obj->makeTriple();
+
+  if (triple.getArch() == llvm::Triple::aarch64 ||
+      triple.getArch() == llvm::Triple::riscv64) {
+    return 8;
+  } else if (triple.getArch() == llvm::Triple::riscv32) {
+    return 4;
+  }
+  throw std::runtime_error("Unsupported architecture");
+}
+
+CapFormat DwarfSource::getCapFormat() const {
+  auto *obj = dictx_->getDWARFObj().getFile();
+  assert(obj != nullptr && "Invalid DWARF source");
+  auto triple = obj->makeTriple();
+
+  if (triple.getArch() == llvm::Triple::aarch64) {
+    return CapFormat::Morello;
+  } else if (triple.getArch() == llvm::Triple::riscv64) {
+    return CapFormat::RISCV128;
+  } else if (triple.getArch() == llvm::Triple::riscv32) {
+    return CapFormat::RISCV64;
+  }
+  throw std::runtime_error("Unsupported architecture");
+}
+
 std::pair<uint64_t, uint64_t>
 DwarfSource::findRepresentableRange(uint64_t base, uint64_t length) const {
   auto *obj = dictx_->getDWARFObj().getFile();
@@ -308,14 +480,56 @@ uint64_t DwarfSource::findMaxRepresentableLength(uint64_t base) const {
   throw std::runtime_error("Unsupported architecture");
 }
 
+std::optional<CapFormat> parseCapFormat(std::string_view name) {
+  if (name == "morello")
+    return CapFormat::Morello;
+  if (name == "riscv128")
+    return CapFormat::RISCV128;
+  if (name == "riscv64")
+    return CapFormat::RISCV64;
+  return std::nullopt;
+}
+
+std::pair<uint64_t, uint64_t> findRepresentablePadding(CapFormat format,
+                                                       uint64_t length) {
+  switch (format) {
+  case CapFormat::Morello:
+    return findRepresentablePaddingImpl<CompressedCap128m>(length);
+  case CapFormat::RISCV128:
+    return findRepresentablePaddingImpl<CompressedCap128>(length);
+  case CapFormat::RISCV64:
+    return findRepresentablePaddingImpl<CompressedCap64>(length);
+  }
+  throw std::runtime_error("Unsupported capability format");
+}
+
+std::pair<uint64_t, uint64_t>
+DwarfSource::findRepresentablePadding(uint64_t length) const {
+  return cheri::findRepresentablePadding(getCapFormat(), length);
+}
+
 DwarfScraper::DwarfScraper(StorageManager &sm,
                            std::unique_ptr<const DwarfSource> dwsrc)
-    : sm_(sm), dwsrc_(std::move(dwsrc)) {}
+    : sm_(sm), dwsrc_(std::move(dwsrc)), dry_run_(false), shard_index_(0),
+      shard_count_(1), resolve_type_timing_(stats_.phase("resolve_type")) {}
 
 void DwarfScraper::run(std::stop_token stop_tok) {
   auto &dictx = dwsrc_->getContext();
 
-  // auto timing = stats_.Timing("elapsed_time");
+  auto storage_before = StorageManager::threadTiming();
+  auto storage_stats_before = StorageManager::threadStats();
+  auto timing = stats_.Timing("elapsed_time");
+  if (progress_) {
+    // Units in this shard, this is an estimate as the count includes
+    // units that are not compilation units.
+    unsigned long units = dictx.getNumCompileUnits();
+    progress_->jobs_started.fetch_add(1, std::memory_order_relaxed);
+    progress_->units_total.fetch_add(
+        (units + shard_count_ - 1 - shard_index_) / shard_count_,
+        std::memory_order_relaxed);
+  }
+  auto &unit_scan_timing = stats_.phase("unit_scan");
+  unsigned long unit_index = 0;
   for (auto &unit : dictx.info_section_units()) {
     if (stop_tok.stop_requested()) {
       break;
@@ -326,8 +540,16 @@ void DwarfScraper::run(std::stop_token stop_tok) {
     if (unit->getVersion() < 4) {
       throw std::runtime_error("Unsupported DWARF version");
     }
+    if (unit_index++ % shard_count_ != shard_index_) {
+      continue;
+    }
 
+    TimingScope unit_timing(unit_scan_timing);
     llvm::DWARFDie unit_die = unit->getUnitDIE(false);
+    std::string unit_name;
+    if (Tracer::enabled())
+      unit_name = getStrAttr(unit_die, dwarf::DW_AT_name).value_or("");
+    TraceScope span("unit", unit_name);
     beginUnit(unit_die);
     try {
       /* Iterate over DIEs in the unit */
@@ -344,12 +566,41 @@ void DwarfScraper::run(std::stop_token stop_tok) {
                   << " reason: " << ex.what();
       stats_.errors.push_back(ex.what());
     }
+    stats_.memory.state_peak_bytes =
+        std::max(stats_.memory.state_peak_bytes, stateBytes());
     endUnit(unit_die);
+
+    // The context keeps the extracted DIEs until the job ends
+    auto num_dies = unit->getNumDIEs();
+    stats_.units++;
+    stats_.dies += num_dies;
+    stats_.memory.die_bytes += num_dies * sizeof(llvm::DWARFDebugInfoEntry);
+    if (progress_) {
+      progress_->units.fetch_add(1, std::memory_order_relaxed);
+      progress_->dies.fetch_add(num_dies, std::memory_order_relaxed);
+    }
+  }
+
+  if (!stop_tok.stop_requested()) {
+    stats_.memory.state_peak_bytes =
+        std::max(stats_.memory.state_peak_bytes, stateBytes());
+    endRun();
   }
+
+  // Jobs run on a single pool thread, so the thread storage timing
+  // difference belongs to this job.
+  auto &storage_after = StorageManager::threadTiming();
+  stats_.profile["db_lock_wait"].merge(
+      storage_after.lock_wait.since(storage_before.lock_wait));
+  stats_.profile["db_transaction"].merge(
+      storage_after.transaction.since(storage_before.transaction));
+  stats_.storage.merge(
+      StorageManager::threadStats().since(storage_stats_before));
 }
 
 TypeDesc DwarfScraper::resolveTypeDie(const llvm::DWARFDie &die) {
   assert(die.isValid() && "Invalid DIE");
+  TimingScope timing(resolve_type_timing_);
   TypeDesc desc(die);
 
   // Resolve the type name in a readable form.
@@ -527,9 +778,71 @@ fs::path DwarfScraper::normalizePath(fs::path path) {
   return path;
 }
 
+void DwarfScraper::initBinarySchema() {
+  // clang-format off
+  sm_.query_tx("CREATE TABLE IF NOT EXISTS binary ("
+            "id INTEGER PRIMARY KEY,"
+            // The executable file
+            "file TEXT NOT NULL,"
+            // ABI pointer and capability size, these identify the
+            // ABI the layouts in the binary have been compiled for
+            "pointer_size INTEGER NOT NULL,"
+            "cap_size INTEGER NOT NULL,"
+            "UNIQUE(file))");
+  // clang-format on
+}
+
+QVariant DwarfScraper::recordBinary(StorageManager &sm) {
+  // clang-format off
+  auto insert_binary = sm.prepare(
+      "INSERT INTO binary (file, pointer_size, cap_size) "
+      "VALUES (:file, :pointer_size, :cap_size) "
+      "ON CONFLICT DO NOTHING RETURNING id");
+
+  auto fetch_binary = sm.prepare(
+      "SELECT id FROM binary WHERE "
+      "file = :file");
+  // clang-format on
+
+  auto binary_path = QString::fromStdString(source().getPath().string());
+  insert_binary.bindValue(":file", binary_path);
+  insert_binary.bindValue(":pointer_size", source().getABIPointerSize());
+  insert_binary.bindValue(":cap_size", source().getABICapabilitySize());
+  if (!sm.exec(insert_binary)) {
+    // Failed, abort the transaction
+    qCritical() << "Failed to insert binary:" << insert_binary.lastQuery();
+    throw DBError(insert_binary.lastError());
+  }
+  QVariant binary_id;
+  if (!insert_binary.first()) {
+    fetch_binary.bindValue(":file", binary_path);
+    if (!sm.exec(fetch_binary)) {
+      qCritical() << "Failed to fetch binary ID:" << fetch_binary.lastQuery();
+      throw DBError(fetch_binary.lastError());
+    }
+    if (!fetch_binary.first()) {
+      qCritical() << "Binary record colud not be found";
+      throw ScraperError("Unexpected missing binary");
+    }
+    binary_id = fetch_binary.value(0);
+    fetch_binary.finish();
+  } else {
+    binary_id = insert_binary.value(0);
+  }
+  insert_binary.finish();
+
+  return binary_id;
+}
+
 ScraperResult DwarfScraper::result() {
   ScraperResult r(stats_);
   r.source = dwsrc_->getPath();
+  r.scraper = name();
+  r.profile["binary_load"].merge(dwsrc_->loadTiming());
+  r.profile["dwarf_context"].merge(dwsrc_->contextTiming());
+  // The shards of a binary map the same file, only count it once
+  if (shard_index_ == 0)
+    r.memory.mapped_bytes = dwsrc_->mappedBytes();
 
   return r;
 }
@@ -27,20 +27,28 @@
 
 #pragma once
 
+#include <cassert>
 #include <chrono>
 #include <concepts>
 #include <filesystem>
+#include <functional>
 #include <memory>
 #include <optional>
 #include <stop_token>
+#include <string_view>
 #include <type_traits>
+#include <unordered_map>
+#include <vector>
 
 #include <llvm/DebugInfo/DWARF/DWARFContext.h>
 #include <llvm/Object/Binary.h>
 
 #include <QDebug>
+#include <QVariant>
 
+#include "progress.hh"
 #include "storage.hh"
+#include "timing.hh"
 
 namespace cheri {
 
@@ -128,21 +136,122 @@ struct TypeDesc {
   std::optional<TypeDecl> decl;
 };
 
+/**
+ * Hash for the profile map that allows lookups by string_view.
+ */
+struct ProfileHash {
+  using is_transparent = void;
+  std::size_t operator()(std::string_view name) const noexcept {
+    return std::hash<std::string_view>{}(name);
+  }
+};
+
+/**
+ * Estimated memory used by a scraper job.
+ * These are estimates from the container sizes, the allocator overhead
+ * is not accounted for.
+ */
+struct MemoryInfo {
+  MemoryInfo() : mapped_bytes(0), die_bytes(0), state_peak_bytes(0) {}
+
+  /**
+   * Accumulate the memory of another job.
+   * The mapped and DIE bytes are added, the state peak is the largest one.
+   */
+  void merge(const MemoryInfo &other);
+
+  uint64_t total() const {
+    return mapped_bytes + die_bytes + state_peak_bytes;
+  }
+
+  // Size of the mapped binary, only reported by the first shard of a binary
+  uint64_t mapped_bytes;
+  // DIE arrays extracted by the DWARF context, retained until the job ends
+  uint64_t die_bytes;
+  // High-water mark of the scraper in-memory state
+  uint64_t state_peak_bytes;
+};
+
+/**
+ * Estimated heap memory owned by a string, excluding the string object.
+ */
+inline uint64_t estimateHeapBytes(const std::string &str) {
+  // Short strings are stored inline
+  static const size_t inline_capacity = std::string().capacity();
+  return str.capacity() > inline_capacity ? str.capacity() + 1 : 0;
+}
+
+/**
+ * Estimated memory of an unordered map, excluding the heap memory owned
+ * by the values.
+ */
+template <typename Map> uint64_t estimateTableBytes(const Map &map) {
+  // Each node holds the value, the next node pointer and the hash
+  constexpr size_t node_overhead = 2 * sizeof(void *);
+  return map.bucket_count() * sizeof(void *) +
+         map.size() * (sizeof(typename Map::value_type) + node_overhead);
+}
+
+/**
+ * Process-wide peak resident set size, in bytes.
+ */
+uint64_t peakResidentBytes();
+
 /**
  * Scraper execution result.
  */
 struct ScraperResult {
-  ScraperResult() : dup_structs(0), dup_members(0) {}
+  ScraperResult()
+      : dup_structs(0), dup_members(0), units(0), dies(0), layouts(0),
+        members(0),
+        imprecise_members(0), total_padding(0), globals(0),
+        imprecise_globals(0), frames(0), locals(0), imprecise_locals(0) {}
   virtual ~ScraperResult() = default;
 
-  // TimingScope Timing(std::string_view name);
+  /**
+   * Accumulate the counters from another result.
+   */
+  void merge(const ScraperResult &other);
+
+  /**
+   * Time the enclosing scope under the given phase name.
+   * Nested phases are timed independently, so their times overlap.
+   */
+  TimingScope Timing(std::string_view name);
+
+  /**
+   * Accumulated time of a phase, created if missing.
+   * The reference stays valid for the lifetime of the result, so
+   * frequently timed phases can be looked up once.
+   */
+  TimingInfo &phase(std::string_view name);
 
   std::filesystem::path source;
-  // std::unordered_map<std::string, TimingInfo> profile;
+  // Name of the scraper that produced the result
+  std::string scraper;
+  std::unordered_map<std::string, TimingInfo, ProfileHash, std::equal_to<>>
+      profile;
   std::vector<std::string> errors;
+  MemoryInfo memory;
+  StorageStats storage;
 
+  // Layouts and members skipped because they were already scanned in
+  // this job or already recorded in the database
   unsigned long dup_structs;
   unsigned long dup_members;
+
+  // Counters of the scanned data, also collected in dry-run mode
+  unsigned long long units;
+  unsigned long long dies;
+  unsigned long long layouts;
+  unsigned long long members;
+  unsigned long long imprecise_members;
+  unsigned long long total_padding;
+  unsigned long long globals;
+  unsigned long long imprecise_globals;
+  unsigned long long frames;
+  unsigned long long locals;
+  unsigned long long imprecise_locals;
 };
 
 QDebug operator<<(QDebug dbg, const ScraperResult &sr);
@@ -172,6 +281,39 @@ std::optional<unsigned long> getULongAttr(const llvm::DWARFDie &die,
 std::optional<std::string> getStrAttr(const llvm::DWARFDie &die,
                                       llvm::dwarf::Attribute attr);
 
+/**
+ * Compressed capability formats, for the analyses that run without
+ * a binary to derive the format from.
+ */
+enum class CapFormat {
+  Morello = 1,
+  RISCV128 = 2,
+  RISCV64 = 3,
+};
+
+/**
+ * Parse a capability format name, one of 'morello', 'riscv128', 'riscv64'.
+ */
+std::optional<CapFormat> parseCapFormat(std::string_view name);
+
+/**
+ * Same as DwarfSource::findRepresentablePadding() for an explicit
+ * capability format.
+ */
+std::pair<uint64_t, uint64_t> findRepresentablePadding(CapFormat format,
+                                                       uint64_t length);
+
+/**
+ * Allocated data section of the binary.
+ */
+struct SectionInfo {
+  std::string name;
+  uint64_t addr;
+  uint64_t size;
+  // The section has no file contents, e.g. .bss
+  bool is_bss;
+};
+
 /**
  * A shared DWARF object, possibly between multiple scrapers.
  */
@@ -183,6 +325,11 @@ public:
   llvm::DWARFContext &getContext() const;
   int getABIPointerSize() const;
   int getABICapabilitySize() const;
+  int getABIAddressSize() const;
+  /**
+   * Compressed capability format of the binary architecture.
+   */
+  CapFormat getCapFormat() const;
   std::pair<uint64_t, uint64_t> findRepresentableRange(uint64_t base,
                                                        uint64_t length) const;
   uint64_t findRepresentableAlign(uint64_t length) const;
@@ -205,12 +352,34 @@ public:
    * Place it here because it may be arch-specific.
    */
   short findRequiredPrecision(uint64_t base, uint64_t length) const;
+  /**
+   * Time spent loading the binary and creating the DWARF context.
+   */
+  const TimingInfo &loadTiming() const { return load_timing_; }
+  const TimingInfo &contextTiming() const { return context_timing_; }
+  /**
+   * Size of the binary mapped in memory.
+   */
+  uint64_t mappedBytes() const;
   uint64_t findMaxRepresentableLength(uint64_t length) const;
+  /**
+   * Find the smallest base alignment and padded length that make a
+   * sub-object of the given length exactly representable.
+   * Returns the pair (alignment, padded_length), the alignment is in bytes
+   * rather than in the mask form returned by findRepresentableAlign().
+   */
+  std::pair<uint64_t, uint64_t> findRepresentablePadding(uint64_t length) const;
+  /**
+   * Return the allocated data and bss sections, sorted by address.
+   */
+  std::vector<SectionInfo> getDataSections() const;
 
 private:
   std::filesystem::path path_;
   std::unique_ptr<llvm::DWARFContext> dictx_;
   llvm::object::OwningBinary<llvm::object::Binary> owned_binary_;
+  TimingInfo load_timing_;
+  TimingInfo context_timing_;
 };
 
 /**
@@ -224,6 +393,7 @@ class DwarfScraper {
 public:
   DwarfScraper(StorageManager &sm, std::unique_ptr<const DwarfSource> dwsrc);
   DwarfScraper(const DwarfScraper &other) = delete;
+  virtual ~DwarfScraper() = default;
 
   /**
    * Public name of the scraper
@@ -252,6 +422,31 @@ public:
     strip_prefix_ = prefix;
   }
 
+  /**
+   * Scan without touching the database, only the result counters are kept.
+   */
+  void setDryRun(bool enable) { dry_run_ = enable; }
+  bool isDryRun() const { return dry_run_; }
+
+  /**
+   * Only scan the compilation units with index % count == index, so that
+   * multiple jobs can split the units of a large binary.
+   * This is only valid for scrapers that have no binary-wide state.
+   */
+  void setShard(unsigned long index, unsigned long count) {
+    assert(count > 0 && index < count && "Invalid shard");
+    shard_index_ = index;
+    shard_count_ = count;
+  }
+
+  /**
+   * Report the scanned units and the recorded data to shared progress
+   * counters.
+   */
+  void setProgress(std::shared_ptr<ProgressCounters> progress) {
+    progress_ = std::move(progress);
+  }
+
   /**
    * Resolve the type description information associated with a DIE.
    * The DIE must be a DW_TAG_*_type DIE.
@@ -275,12 +470,37 @@ protected:
   virtual void beginUnit(llvm::DWARFDie &unit_die) = 0;
   virtual void endUnit(llvm::DWARFDie &unit_die) = 0;
 
+  /**
+   * Hook that is called when all the compilation units have been scanned.
+   * This is not called if the scraper is stopped early.
+   */
+  virtual void endRun() {}
+
+  /**
+   * Estimated memory used by the scraper in-memory state.
+   * This is sampled before the end of each compilation unit and before
+   * the end of the run, so it should be cheap compared to a unit scan.
+   */
+  virtual uint64_t stateBytes() const { return 0; }
+
   /**
    * Given an absolute path from the DWARF information, apply
    * transformations to normalize it for the database.
    */
   std::filesystem::path normalizePath(std::filesystem::path path);
 
+  /**
+   * Create the binary table shared by the scrapers, if missing.
+   */
+  void initBinarySchema();
+
+  /**
+   * Insert the binary for the current source in the binary table, if
+   * missing, and return its ID.
+   * This must be called within a storage transaction.
+   */
+  QVariant recordBinary(StorageManager &sm);
+
   /**
    * Reference to the shared storage manager that provides per-thread
    * database connections.
@@ -296,8 +516,21 @@ protected:
    */
   std::optional<std::filesystem::path> strip_prefix_;
 
+  /* Discard the scanned data instead of recording it */
+  bool dry_run_;
+
+  /* Compilation unit shard scanned by this scraper */
+  unsigned long shard_index_;
+  unsigned long shard_count_;
+
+  /* Shared progress counters, if enabled */
+  std::shared_ptr<ProgressCounters> progress_;
+
   /* Statistics */
   ScraperResult stats_;
+
+  /* Timing of the frequently called phases, resolved once per job */
+  TimingInfo &resolve_type_timing_;
 };
 
 } /* namespace cheri */
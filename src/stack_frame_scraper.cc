@@ -0,0 +1,417 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Alfredo Mazzinghi
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+#include <QVariant>
+
+#include <algorithm>
+#include <format>
+
+#include "llvm/DebugInfo/DWARF/DWARFExpression.h"
+#include "llvm/Support/DataExtractor.h"
+
+#include "stack_frame_scraper.hh"
+
+namespace dwarf = llvm::dwarf;
+using FLIKind = llvm::DILineInfoSpecifier::FileLineInfoKind;
+
+namespace cheri {
+
+namespace {
+
+bool isMisaligned(int64_t offset, uint64_t align) {
+  align = std::max<uint64_t>(align, 1);
+  return (static_cast<uint64_t>(offset) & (align - 1)) != 0;
+}
+
+} // namespace
+
+unsigned long long localFrameGrowth(const StackLocalInfo &local,
+                                    uint64_t stack_align) {
+  unsigned long long growth = local.padded_size - local.size;
+  if (local.required_align > stack_align) {
+    // The frame base must be realigned before the local can be placed
+    growth += local.required_align - stack_align;
+  }
+  if (isMisaligned(local.fb_offset, local.required_align)) {
+    growth += local.required_align - 1;
+  }
+  return growth;
+}
+
+bool StackLocalInfo::isImprecise(uint64_t stack_align) const {
+  return localFrameGrowth(*this, stack_align) != 0;
+}
+
+void StackFrameScraper::initSchema() {
+  // clang-format off
+  /* Initialize tables */
+  initBinarySchema();
+
+  sm_.query_tx("CREATE TABLE IF NOT EXISTS stack_frame ("
+            "id INTEGER PRIMARY KEY,"
+            // Binary ID where the function is found
+            "binary_id INTEGER NOT NULL,"
+            // Name of the function
+            "name TEXT NOT NULL,"
+            // File where the function is defined
+            "file TEXT NOT NULL,"
+            // Line where the function is defined
+            "line INTEGER NOT NULL,"
+            // Lowest code address of the function (not relocated), this
+            // distinguishes template instances and static functions that
+            // share the same declaration
+            "low_pc INTEGER NOT NULL,"
+            // Compilation unit containing the function
+            "unit TEXT NOT NULL,"
+            // Number of stack locals in the frame
+            "locals INTEGER NOT NULL,"
+            // Number of locals that can not have exact bounds
+            "imprecise_locals INTEGER NOT NULL,"
+            // Estimated frame growth for exact bounds on every local
+            "frame_padding INTEGER NOT NULL,"
+            "FOREIGN KEY (binary_id) REFERENCES binary (id),"
+            "UNIQUE(binary_id, name, file, line, low_pc))");
+
+  sm_.query_tx("CREATE TABLE IF NOT EXISTS stack_local ("
+            "id INTEGER PRIMARY KEY,"
+            // Frame containing the local
+            "frame INTEGER NOT NULL,"
+            "name TEXT NOT NULL,"
+            "type_name TEXT NOT NULL,"
+            // Offset from the frame base
+            "fb_offset INTEGER NOT NULL,"
+            // Size in bytes
+            "size INTEGER NOT NULL,"
+            // Minimum alignment required for exact bounds, in bytes
+            "required_align INTEGER NOT NULL,"
+            // Padded length required for exact bounds
+            "padded_size INTEGER NOT NULL,"
+            // Estimated frame growth for exact bounds on this local
+            "growth INTEGER NOT NULL,"
+            // Whether this is a formal parameter spilled to the stack
+            "is_param INTEGER DEFAULT 0 NOT NULL"
+            " CHECK(is_param >= 0 AND is_param <= 1),"
+            // Whether the local can not have exact bounds
+            "is_imprecise INTEGER DEFAULT 0 NOT NULL"
+            " CHECK(is_imprecise >= 0 AND is_imprecise <= 1),"
+            "FOREIGN KEY (frame) REFERENCES stack_frame (id),"
+            "UNIQUE(frame, name, fb_offset))");
+  // clang-format on
+}
+
+void StackFrameScraper::beginUnit(llvm::DWARFDie &unit_die) {
+  auto at_name = unit_die.find(dwarf::DW_AT_name);
+  if (at_name) {
+    llvm::Expected name = at_name->getAsCString();
+    if (name) {
+      current_unit_ = *name;
+    } else {
+      qCritical() << "Invalid compilation unit, can't extract AT_name";
+      throw ScraperError("Invalid compilation unit:", name);
+    }
+  } else {
+    qCritical() << "Invalid compliation unit, missing AT_name";
+    throw ScraperError("Invalid compliation unit");
+  }
+  qDebug() << "Enter compilation unit" << current_unit_;
+}
+
+void StackFrameScraper::endUnit(llvm::DWARFDie &unit_die) {
+  qDebug() << "Done compilation unit" << current_unit_;
+
+  uint64_t stack_align = source().getABICapabilitySize();
+  for (auto &frame : frames_) {
+    stats_.frames++;
+    stats_.locals += frame.locals.size();
+    stats_.imprecise_locals += std::count_if(
+        frame.locals.begin(), frame.locals.end(),
+        [&](auto &local) { return local.isImprecise(stack_align); });
+  }
+  if (!dry_run_ && !frames_.empty()) {
+    recordFrames();
+  }
+  frames_.clear();
+}
+
+uint64_t StackFrameScraper::stateBytes() const {
+  uint64_t bytes = frames_.capacity() * sizeof(StackFrameInfo);
+  for (auto &frame : frames_) {
+    bytes += estimateHeapBytes(frame.name) + estimateHeapBytes(frame.file) +
+             frame.locals.capacity() * sizeof(StackLocalInfo);
+    for (auto &local : frame.locals) {
+      bytes += estimateHeapBytes(local.name) + estimateHeapBytes(local.type_name);
+    }
+  }
+  return bytes;
+}
+
+bool StackFrameScraper::visit_namespace(llvm::DWARFDie &die) {
+  for (auto child : die.children()) {
+    doVisit(child);
+  }
+  return false;
+}
+
+bool StackFrameScraper::visit_subprogram(llvm::DWARFDie &die) {
+  // Ignore declarations and abstract instances of inline functions,
+  // these do not have a frame.
+  if (die.find(dwarf::DW_AT_declaration)) {
+    return false;
+  }
+  if (!die.find(dwarf::DW_AT_low_pc) && !die.find(dwarf::DW_AT_ranges)) {
+    return false;
+  }
+
+  StackFrameInfo frame;
+  if (auto name = die.getName(llvm::DINameKind::ShortName)) {
+    frame.name = name;
+  } else {
+    frame.name = anonymousName(die);
+  }
+  frame.file =
+      normalizePath(die.getDeclFile(FLIKind::AbsoluteFilePath)).string();
+  frame.line = die.getDeclLine();
+  auto ranges = die.getAddressRanges();
+  if (auto err = ranges.takeError()) {
+    qCritical() << std::format("Can not extract the address ranges of DIE "
+                               "{:#x} in {}",
+                               die.getOffset(), current_unit_);
+    throw ScraperError(llvm::toString(std::move(err)));
+  }
+  if (ranges->empty()) {
+    return false;
+  }
+  frame.low_pc = ranges->front().LowPC;
+  for (auto &range : *ranges) {
+    frame.low_pc = std::min<unsigned long long>(frame.low_pc, range.LowPC);
+  }
+
+  collectLocals(die, frame);
+  if (frame.locals.empty()) {
+    return false;
+  }
+
+  uint64_t stack_align = source().getABICapabilitySize();
+  for (auto &local : frame.locals) {
+    frame.frame_padding += localFrameGrowth(local, stack_align);
+  }
+  qDebug() << "Found stack frame "
+           << std::format("{}:{} {} locals={} padding={:#x}", frame.file,
+                          frame.line, frame.name, frame.locals.size(),
+                          frame.frame_padding);
+  frames_.emplace_back(std::move(frame));
+
+  return false;
+}
+
+void StackFrameScraper::collectLocals(const llvm::DWARFDie &scope,
+                                      StackFrameInfo &frame) {
+  for (auto child : scope.children()) {
+    switch (child.getTag()) {
+    case dwarf::DW_TAG_lexical_block:
+    case dwarf::DW_TAG_inlined_subroutine:
+      // Inlined locals are allocated in the frame of the caller
+      collectLocals(child, frame);
+      continue;
+    case dwarf::DW_TAG_variable:
+    case dwarf::DW_TAG_formal_parameter:
+      break;
+    default:
+      continue;
+    }
+
+    auto offset = getFrameOffset(child);
+    if (!offset) {
+      continue;
+    }
+
+    // Locals of inlined subroutines refer to the abstract origin
+    llvm::DWARFDie def = child;
+    if (!def.find(dwarf::DW_AT_type)) {
+      def = child.getAttributeValueAsReferencedDie(
+          dwarf::DW_AT_abstract_origin);
+    }
+    if (!def.isValid() || !def.find(dwarf::DW_AT_type)) {
+      qDebug() << "Skip stack local without type"
+               << std::format("{:#x}", child.getOffset());
+      continue;
+    }
+    auto type_die = def.getAttributeValueAsReferencedDie(dwarf::DW_AT_type)
+                        .resolveTypeUnitReference();
+    TypeDesc desc = resolveTypeDie(type_die);
+
+    StackLocalInfo local;
+    if (auto name = child.getName(llvm::DINameKind::ShortName)) {
+      local.name = name;
+    } else {
+      local.name = anonymousName(child);
+    }
+    local.type_name = desc.name;
+    local.fb_offset = *offset;
+    local.size = desc.byte_size;
+    std::tie(local.required_align, local.padded_size) =
+        source().findRepresentablePadding(local.size);
+    local.is_param = child.getTag() == dwarf::DW_TAG_formal_parameter;
+    frame.locals.emplace_back(std::move(local));
+  }
+}
+
+std::optional<int64_t>
+StackFrameScraper::getFrameOffset(const llvm::DWARFDie &die) {
+  // We match the exact expression DW_OP_fbreg(x)
+  if (!die.find(dwarf::DW_AT_location)) {
+    return std::nullopt;
+  }
+
+  auto loc_vec = die.getLocations(dwarf::DW_AT_location);
+  if (auto err = loc_vec.takeError()) {
+    qCritical() << std::format(
+        "Can not extract DW_AT_location data for DIE {:#x} in {}",
+        die.getOffset(), current_unit_);
+    throw ScraperError(llvm::toString(std::move(err)));
+  }
+  auto &unit = *die.getDwarfUnit();
+  auto addr_size = unit.getAddressByteSize();
+  for (auto &loc : *loc_vec) {
+    llvm::DataExtractor data(loc.Expr, source().getContext().isLittleEndian(),
+                             addr_size);
+    llvm::DWARFExpression expr(data, addr_size);
+    auto it = expr.begin();
+    if (it == expr.end() || it->getCode() != dwarf::DW_OP_fbreg) {
+      continue;
+    }
+    auto offset = static_cast<int64_t>(it->getRawOperand(0));
+    if (++it != expr.end()) {
+      continue;
+    }
+    return offset;
+  }
+
+  return std::nullopt;
+}
+
+void StackFrameScraper::recordFrames() {
+  sm_.transaction([&](StorageManager &sm) {
+    // clang-format off
+    auto insert_frame = sm.prepare(
+        "INSERT INTO stack_frame (binary_id, name, file, line, low_pc, unit, "
+        "locals, imprecise_locals, frame_padding) "
+        "VALUES (:binary_id, :name, :file, :line, :low_pc, :unit, :locals, "
+        ":imprecise_locals, :frame_padding) "
+        "ON CONFLICT DO NOTHING RETURNING id");
+
+    auto fetch_frame = sm.prepare(
+        "SELECT id FROM stack_frame WHERE "
+        "binary_id = :binary_id AND name = :name AND file = :file AND "
+        "line = :line AND low_pc = :low_pc");
+
+    auto insert_local = sm.prepare(
+        "INSERT INTO stack_local (frame, name, type_name, fb_offset, size, "
+        "required_align, padded_size, growth, is_param, is_imprecise) "
+        "VALUES (:frame, :name, :type_name, :fb_offset, :size, "
+        ":required_align, :padded_size, :growth, :is_param, :is_imprecise) "
+        "ON CONFLICT DO NOTHING");
+    // clang-format on
+
+    QVariant binary_id = recordBinary(sm);
+    uint64_t stack_align = source().getABICapabilitySize();
+    for (auto &frame : frames_) {
+      auto imprecise = std::count_if(
+          frame.locals.begin(), frame.locals.end(),
+          [&](auto &local) { return local.isImprecise(stack_align); });
+      auto file = QString::fromStdString(frame.file);
+
+      insert_frame.bindValue(":binary_id", binary_id);
+      insert_frame.bindValue(":name", QString::fromStdString(frame.name));
+      insert_frame.bindValue(":file", file);
+      insert_frame.bindValue(":line", frame.line);
+      insert_frame.bindValue(":low_pc", frame.low_pc);
+      insert_frame.bindValue(":unit", QString::fromStdString(current_unit_));
+      insert_frame.bindValue(":locals",
+                             static_cast<qulonglong>(frame.locals.size()));
+      insert_frame.bindValue(":imprecise_locals",
+                             static_cast<qlonglong>(imprecise));
+      insert_frame.bindValue(":frame_padding", frame.frame_padding);
+      if (!sm.exec(insert_frame)) {
+        qCritical() << "Failed to insert stack frame:"
+                    << insert_frame.lastQuery();
+        throw DBError(insert_frame.lastError());
+      }
+
+      QVariant frame_id;
+      if (!insert_frame.first()) {
+        fetch_frame.bindValue(":binary_id", binary_id);
+        fetch_frame.bindValue(":name", QString::fromStdString(frame.name));
+        fetch_frame.bindValue(":file", file);
+        fetch_frame.bindValue(":line", frame.line);
+        fetch_frame.bindValue(":low_pc", frame.low_pc);
+        if (!sm.exec(fetch_frame)) {
+          qCritical() << "Failed to fetch stack frame ID:"
+                      << fetch_frame.lastQuery();
+          throw DBError(fetch_frame.lastError());
+        }
+        if (!fetch_frame.first()) {
+          qCritical() << "Record for existing stack frame could not be found";
+          throw ScraperError("Unexpected missing stack_frame");
+        }
+        frame_id = fetch_frame.value(0);
+        fetch_frame.finish();
+      } else {
+        frame_id = insert_frame.value(0);
+      }
+      insert_frame.finish();
+
+      for (auto &local : frame.locals) {
+        insert_local.bindValue(":frame", frame_id);
+        insert_local.bindValue(":name", QString::fromStdString(local.name));
+        insert_local.bindValue(":type_name",
+                               QString::fromStdString(local.type_name));
+        insert_local.bindValue(":fb_offset",
+                               static_cast<qlonglong>(local.fb_offset));
+        insert_local.bindValue(":size", local.size);
+        insert_local.bindValue(
+            ":required_align",
+            static_cast<unsigned long long>(local.required_align));
+        insert_local.bindValue(":padded_size", local.padded_size);
+        insert_local.bindValue(":growth",
+                               localFrameGrowth(local, stack_align));
+        insert_local.bindValue(":is_param", local.is_param);
+        insert_local.bindValue(":is_imprecise",
+                               local.isImprecise(stack_align));
+        if (!sm.exec(insert_local)) {
+          qCritical() << "Failed to insert stack local:"
+                      << insert_local.lastQuery();
+          throw DBError(insert_local.lastError());
+        }
+        insert_local.finish();
+      }
+    }
+  });
+}
+
+} /* namespace cheri */
@@ -0,0 +1,154 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Alfredo Mazzinghi
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "scraper.hh"
+
+namespace cheri {
+
+/**
+ * Local variable or parameter stored in a stack frame.
+ */
+struct StackLocalInfo {
+  StackLocalInfo()
+      : fb_offset(0), size(0), required_align(0), padded_size(0),
+        is_param(false) {}
+
+  std::string name;
+  std::string type_name;
+  // Offset from the frame base (DW_OP_fbreg)
+  int64_t fb_offset;
+  // Local size (requested size)
+  unsigned long long size;
+  // Minimum alignment required for exact bounds, in bytes
+  uint64_t required_align;
+  // Padded length required for exact bounds
+  unsigned long long padded_size;
+  // Formal parameter spilled to the stack
+  bool is_param;
+
+  /**
+   * Whether the local can not have exact bounds at its current offset,
+   * given the alignment of the frame base.
+   */
+  bool isImprecise(uint64_t stack_align) const;
+};
+
+/**
+ * Estimate the frame growth required to give the local exact bounds.
+ * This is the length padding plus, if the local offset is misaligned,
+ * the worst-case shift to the required alignment. The frame base is
+ * assumed to be aligned to the stack alignment, locals that need a
+ * larger alignment also force the frame to be realigned.
+ */
+unsigned long long localFrameGrowth(const StackLocalInfo &local,
+                                    uint64_t stack_align);
+
+/**
+ * Stack frame of a concrete function.
+ */
+struct StackFrameInfo {
+  StackFrameInfo() : line(0), low_pc(0), frame_padding(0) {}
+
+  std::string name;
+  std::string file;
+  unsigned long long line;
+  // Lowest code address of the function (not relocated)
+  unsigned long long low_pc;
+  // Stack locals in the function and its lexical blocks, including the
+  // locals of inlined subroutines
+  std::vector<StackLocalInfo> locals;
+  // Estimated frame growth for exact bounds on every local
+  unsigned long long frame_padding;
+};
+
+/**
+ * Scraper to extract the stack-allocated locals from DWARF.
+ *
+ * The scraper walks the subprograms and their lexical blocks and annotates
+ * the locals with a frame-base-relative location that need padding for
+ * CHERI representability.
+ * There is no binary-wide state, so the compilation units can be split
+ * across multiple jobs with setShard().
+ */
+class StackFrameScraper : public DwarfScraper {
+public:
+  StackFrameScraper(StorageManager &sm,
+                    std::unique_ptr<const DwarfSource> dwsrc)
+      : DwarfScraper(sm, std::move(dwsrc)) {}
+
+  std::string name() override { return "stack-frame"; }
+
+  bool visit_subprogram(llvm::DWARFDie &die);
+  bool visit_namespace(llvm::DWARFDie &die);
+
+protected:
+  void initSchema() override;
+  void beginUnit(llvm::DWARFDie &unit_die) override;
+  void endUnit(llvm::DWARFDie &unit_die) override;
+  uint64_t stateBytes() const override;
+  bool doVisit(llvm::DWARFDie &die) override {
+    return impl::visitDispatch(*this, die);
+  }
+
+  /**
+   * Collect the stack locals in the children of a subprogram, lexical block
+   * or inlined subroutine.
+   */
+  void collectLocals(const llvm::DWARFDie &scope, StackFrameInfo &frame);
+
+  /**
+   * Extract the frame base offset of a local.
+   * If nullopt is returned, the local is not stored at a fixed offset in
+   * the frame, e.g. it lives in a register or it was optimized out.
+   */
+  std::optional<int64_t> getFrameOffset(const llvm::DWARFDie &die);
+
+  /**
+   * Write the stack frames collected in the current compilation unit.
+   */
+  void recordFrames();
+
+  /**
+   * Compilation unit currently processed
+   */
+  std::string current_unit_;
+
+  /**
+   * Frames with at least one stack local in the current compilation unit.
+   */
+  std::vector<StackFrameInfo> frames_;
+};
+
+} /* namespace cheri */
@@ -26,7 +26,10 @@
  */
 
 #include <cassert>
+#include <chrono>
 #include <condition_variable>
+#include <format>
+#include <optional>
 #include <thread>
 
 #include <QDebug>
@@ -34,6 +37,7 @@
 #include <QtLogging>
 
 #include "storage.hh"
+#include "trace.hh"
 #include "utils.hh"
 
 namespace fs = std::filesystem;
@@ -47,6 +51,31 @@ std::condition_variable db_ready_cond;
 std::mutex db_ready_mut;
 bool db_ready = false;
 
+thread_local StorageTiming thread_timing;
+thread_local StorageStats thread_stats;
+// Rows changed by the statements of the current transaction, if known
+thread_local std::optional<uint64_t> thread_tx_rows;
+
+using Clock = std::chrono::steady_clock;
+
+uint64_t elapsedNanos(Clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() -
+                                                              start)
+      .count();
+}
+
+/**
+ * Record the time since start in both the phase timing and the latency
+ * distribution, from a single clock read.
+ */
+void recordElapsed(Clock::time_point start, TimingInfo &timing,
+                   Histogram &latency) {
+  auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      Clock::now() - start);
+  timing.add(elapsed);
+  latency.record(elapsed.count());
+}
+
 /**
  * Helper to execute a query and fail with an exception.
  */
@@ -75,6 +104,26 @@ QSqlQuery execQuery(const QSqlDatabase &db, const std::string &sql_expr) {
   return q;
 }
 
+/**
+ * Same as execQuery(), recording the statement latency.
+ */
+QSqlQuery execTimedQuery(const QSqlDatabase &db, const std::string &sql_expr) {
+  auto start = Clock::now();
+  auto q = execQuery(db, sql_expr);
+  thread_stats.statement.record(elapsedNanos(start));
+  return q;
+}
+
+/**
+ * Format a latency distribution in microseconds.
+ */
+std::string formatLatency(const char *name, const Histogram &h) {
+  constexpr double kMicro = 1000;
+  return std::format("{} p50={:.1f}us p99={:.1f}us max={:.1f}us", name,
+                     h.percentile(50) / kMicro, h.percentile(99) / kMicro,
+                     h.max() / kMicro);
+}
+
 /**
  * Per-worker thread database connection initializer.
  */
@@ -126,31 +175,79 @@ namespace cheri {
 
 Q_LOGGING_CATEGORY(storage, "storage")
 
-StorageManager::StorageManager(fs::path db_path) : db_path_(db_path) {}
+void StorageStats::merge(const StorageStats &other) {
+  lock_wait.merge(other.lock_wait);
+  transaction.merge(other.transaction);
+  commit.merge(other.commit);
+  statement.merge(other.statement);
+  rows.merge(other.rows);
+}
+
+StorageStats StorageStats::since(const StorageStats &before) const {
+  StorageStats delta;
+  delta.lock_wait = lock_wait.since(before.lock_wait);
+  delta.transaction = transaction.since(before.transaction);
+  delta.commit = commit.since(before.commit);
+  delta.statement = statement.since(before.statement);
+  delta.rows = rows.since(before.rows);
+  return delta;
+}
+
+std::string formatStorageStats(const StorageStats &stats) {
+  return std::format("{} transactions, {}, {}, {}, rows/tx p50={} p99={} "
+                     "max={}, {}",
+                     stats.transaction.count(),
+                     formatLatency("lock wait", stats.lock_wait),
+                     formatLatency("transaction", stats.transaction),
+                     formatLatency("commit", stats.commit),
+                     stats.rows.percentile(50), stats.rows.percentile(99),
+                     stats.rows.max(),
+                     formatLatency("query", stats.statement));
+}
+
+StorageManager::StorageManager(fs::path db_path)
+    : db_path_(db_path), used_(false), waiting_(0) {}
 
 StorageManager::~StorageManager() {
-  // Ensure that we drain the WAL
-  execQuery(getWorkerStorage(), "PRAGMA wal_checkpoint(FULL);");
+  // Ensure that we drain the WAL, unless the database was never opened
+  if (used_) {
+    execQuery(getWorkerStorage(), "PRAGMA wal_checkpoint(FULL);");
+  }
 }
 
 QSqlDatabase &StorageManager::getWorkerStorage() {
   static thread_local WorkerDB worker_db(db_path_);
+  used_ = true;
 
   return worker_db.getDatabase();
 }
 
 QSqlQuery StorageManager::query(const std::string &expr) {
-  return execQuery(getWorkerStorage(), expr);
+  return execTimedQuery(getWorkerStorage(), expr);
 }
 
 /*
  * Same as query(), but hold the transaction lock.
  */
 QSqlQuery StorageManager::query_tx(const std::string &expr) {
-  std::lock_guard tx_lock(transaction_mutex_);
-  return execQuery(getWorkerStorage(), expr);
+  auto tx_lock = lockTransaction();
+  return execTimedQuery(getWorkerStorage(), expr);
+}
+
+std::unique_lock<std::mutex> StorageManager::lockTransaction() {
+  TraceScope span("lock_wait");
+  auto start = Clock::now();
+  waiting_.fetch_add(1, std::memory_order_relaxed);
+  std::unique_lock lock(transaction_mutex_);
+  waiting_.fetch_sub(1, std::memory_order_relaxed);
+  recordElapsed(start, thread_timing.lock_wait, thread_stats.lock_wait);
+  return lock;
 }
 
+const StorageTiming &StorageManager::threadTiming() { return thread_timing; }
+
+const StorageStats &StorageManager::threadStats() { return thread_stats; }
+
 QSqlQuery StorageManager::prepare(const std::string &expr) {
   QSqlQuery q(getWorkerStorage());
   q.prepare(QString::fromStdString(expr));
@@ -159,16 +256,56 @@ QSqlQuery StorageManager::prepare(const std::string &expr) {
 }
 
 void StorageManager::transaction(std::function<void(StorageManager &sm)> fn) {
-  std::lock_guard tx_lock(transaction_mutex_);
+  auto tx_lock = lockTransaction();
+  TraceScope span("commit");
+  auto start = Clock::now();
 
+  auto &db = getWorkerStorage();
+  execQuery(db, "BEGIN TRANSACTION");
+  thread_tx_rows = 0;
   try {
-    execQuery(getWorkerStorage(), "BEGIN TRANSACTION");
     fn(*this);
-    execQuery(getWorkerStorage(), "COMMIT TRANSACTION");
+    // The row count is only a statistic, skip it if it is not known
+    if (thread_tx_rows)
+      thread_stats.rows.record(*thread_tx_rows);
+    thread_tx_rows.reset();
+    auto commit_start = Clock::now();
+    execQuery(db, "COMMIT TRANSACTION");
+    thread_stats.commit.record(elapsedNanos(commit_start));
+    recordElapsed(start, thread_timing.transaction, thread_stats.transaction);
   } catch (const std::exception &ex) {
-    execQuery(getWorkerStorage(), "ROLLBACK TRANSACTION");
+    thread_tx_rows.reset();
+    // Do not let a rollback failure hide the original error
+    try {
+      execQuery(db, "ROLLBACK TRANSACTION");
+    } catch (const std::exception &rollback_ex) {
+      qCritical() << "Failed to roll back transaction:" << rollback_ex.what();
+    }
     throw;
   }
 }
 
+bool StorageManager::exec(QSqlQuery &q) {
+  auto start = Clock::now();
+  if (!q.exec())
+    return false;
+  thread_stats.statement.record(elapsedNanos(start));
+
+  if (!thread_tx_rows ||
+      q.lastQuery().trimmed().startsWith("SELECT", Qt::CaseInsensitive))
+    return true;
+  if (q.isSelect()) {
+    // Statements with a RETURNING clause only update the SQLite change
+    // counter once they complete, count the returned row instead.
+    // The queries are not forward-only, so the caller can still seek.
+    if (q.first())
+      *thread_tx_rows += 1;
+  } else if (auto rows = q.numRowsAffected(); rows >= 0) {
+    *thread_tx_rows += rows;
+  } else {
+    thread_tx_rows.reset();
+  }
+  return true;
+}
+
 } /* namespace cheri */
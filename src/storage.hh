@@ -27,9 +27,11 @@
 
 #pragma once
 
+#include <atomic>
 #include <filesystem>
 #include <mutex>
 #include <sstream>
+#include <string>
 #include <stdexcept>
 
 #include <QLoggingCategory>
@@ -37,6 +39,9 @@
 #include <QSqlError>
 #include <QSqlQuery>
 
+#include "histogram.hh"
+#include "timing.hh"
+
 namespace cheri {
 
 Q_DECLARE_LOGGING_CATEGORY(storage)
@@ -51,6 +56,41 @@ public:
   QSqlError error;
 };
 
+/**
+ * Time spent by a thread waiting for the transaction lock and
+ * running transactions.
+ */
+struct StorageTiming {
+  TimingInfo lock_wait;
+  TimingInfo transaction;
+};
+
+/**
+ * Distribution of the storage latencies, in nanoseconds, and of the
+ * rows written by each transaction.
+ */
+struct StorageStats {
+  void merge(const StorageStats &other);
+  StorageStats since(const StorageStats &before) const;
+
+  // Time waiting for the transaction lock
+  Histogram lock_wait;
+  // Transaction time, with the lock held
+  Histogram transaction;
+  // Time to commit a transaction
+  Histogram commit;
+  // Statements run through query(), query_tx() and exec()
+  Histogram statement;
+  // Rows inserted, updated or deleted by each transaction
+  Histogram rows;
+};
+
+/**
+ * Summary of the storage statistics with the p50/p99/max of each
+ * distribution.
+ */
+std::string formatStorageStats(const StorageStats &stats);
+
 /**
  * Manage database interface for a scraper.
  */
@@ -73,9 +113,41 @@ public:
   QSqlQuery prepare(const std::string &expr);
   void transaction(std::function<void(StorageManager &sm)> fn);
 
+  /**
+   * Execute a prepared query, recording the statement latency and the
+   * rows it changes in the current transaction.
+   * Returns the result of QSqlQuery::exec().
+   */
+  bool exec(QSqlQuery &q);
+
+  /**
+   * Storage timing for the calling thread, accumulated over all the
+   * jobs that ran on the thread.
+   */
+  static const StorageTiming &threadTiming();
+
+  /**
+   * Storage latency distributions for the calling thread, accumulated
+   * over all the jobs that ran on the thread.
+   */
+  static const StorageStats &threadStats();
+
+  /**
+   * Number of threads currently waiting for the transaction lock.
+   */
+  unsigned long queueDepth() const {
+    return waiting_.load(std::memory_order_relaxed);
+  }
+
 private:
+  std::unique_lock<std::mutex> lockTransaction();
+
   std::mutex transaction_mutex_;
   std::filesystem::path db_path_;
+  // Whether any worker opened a connection
+  std::atomic<bool> used_;
+  // Threads waiting for the transaction lock
+  std::atomic<unsigned long> waiting_;
 };
 
 } /* namespace cheri */
@@ -0,0 +1,91 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Alfredo Mazzinghi
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <chrono>
+#include <utility>
+
+namespace cheri {
+
+/**
+ * Accumulated time spent in a phase of the scraper.
+ */
+struct TimingInfo {
+  TimingInfo() : total(0), count(0) {}
+
+  void add(std::chrono::nanoseconds elapsed) {
+    total += elapsed;
+    count++;
+  }
+
+  void merge(const TimingInfo &other) {
+    total += other.total;
+    count += other.count;
+  }
+
+  /**
+   * Time accumulated since an earlier copy of the same counter.
+   */
+  TimingInfo since(const TimingInfo &before) const {
+    TimingInfo delta;
+    delta.total = total - before.total;
+    delta.count = count - before.count;
+    return delta;
+  }
+
+  std::chrono::nanoseconds total;
+  unsigned long long count;
+};
+
+/**
+ * Scoped timer that adds the time until destruction to a TimingInfo.
+ * This only reads the steady clock twice, so it can be used around
+ * frequently called functions.
+ */
+class TimingScope {
+  using Clock = std::chrono::steady_clock;
+
+public:
+  explicit TimingScope(TimingInfo &info) : info_(&info), start_(Clock::now()) {}
+  TimingScope(TimingScope &&other)
+      : info_(std::exchange(other.info_, nullptr)), start_(other.start_) {}
+  TimingScope(const TimingScope &other) = delete;
+  TimingScope &operator=(const TimingScope &other) = delete;
+
+  ~TimingScope() {
+    if (info_)
+      info_->add(Clock::now() - start_);
+  }
+
+private:
+  TimingInfo *info_;
+  Clock::time_point start_;
+};
+
+} /* namespace cheri */
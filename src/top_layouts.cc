@@ -0,0 +1,119 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Alfredo Mazzinghi
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+#include <algorithm>
+#include <format>
+
+#include <llvm/ADT/Hashing.h>
+
+#include "top_layouts.hh"
+
+namespace {
+
+/* Order entries so that the lowest score is at the top of the heap */
+bool higherScore(const cheri::RankedLayout &l, const cheri::RankedLayout &r) {
+  return l.score > r.score;
+}
+
+} // namespace
+
+namespace cheri {
+
+std::optional<LayoutMetric> parseLayoutMetric(const std::string &name) {
+  if (name == "padding")
+    return LayoutMetric::Padding;
+  if (name == "imprecise")
+    return LayoutMetric::Imprecise;
+  if (name == "size")
+    return LayoutMetric::Size;
+  return std::nullopt;
+}
+
+std::size_t
+RankedLayoutHash::operator()(const RankedLayout::Key &k) const noexcept {
+  auto &[name, file, line, size, binary] = k;
+  return llvm::hash_combine(name, file, line, size, binary);
+}
+
+unsigned long long TopLayouts::score(const FlattenedLayout &layout) const {
+  switch (metric_) {
+  case LayoutMetric::Padding:
+    return layout.total_padding;
+  case LayoutMetric::Imprecise:
+    return std::count_if(layout.members.begin(), layout.members.end(),
+                         [](auto &m) { return m->is_imprecise; });
+  case LayoutMetric::Size:
+    return layout.size;
+  }
+  return 0;
+}
+
+void TopLayouts::push(RankedLayout entry) {
+  if (limit_ == 0 || in_heap_.contains(entry.key()))
+    return;
+
+  if (heap_.size() == limit_) {
+    if (entry.score <= heap_.front().score)
+      return;
+    std::pop_heap(heap_.begin(), heap_.end(), higherScore);
+    in_heap_.erase(heap_.back().key());
+    heap_.pop_back();
+  }
+  in_heap_.insert(entry.key());
+  heap_.push_back(std::move(entry));
+  std::push_heap(heap_.begin(), heap_.end(), higherScore);
+}
+
+void TopLayouts::merge(const TopLayouts &other) {
+  for (auto &entry : other.heap_)
+    push(entry);
+}
+
+std::vector<RankedLayout> TopLayouts::sorted() const {
+  std::vector<RankedLayout> entries = heap_;
+  std::sort_heap(entries.begin(), entries.end(), higherScore);
+  return entries;
+}
+
+void writeTopReport(std::ostream &os, const std::vector<RankedLayout> &top,
+                    LayoutMetric metric) {
+  const char *metric_name = "padding";
+  if (metric == LayoutMetric::Imprecise)
+    metric_name = "imprecise";
+  else if (metric == LayoutMetric::Size)
+    metric_name = "size";
+
+  os << std::format("Top {} layouts by {}\n", top.size(), metric_name);
+  for (auto &entry : top) {
+    os << std::format("{:>8} {} {}:{} size {:#x} in {}\n", entry.score,
+                      entry.name, entry.file, entry.line, entry.size,
+                      entry.binary);
+  }
+}
+
+} /* namespace cheri */
@@ -0,0 +1,151 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Alfredo Mazzinghi
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <tuple>
+#include <unordered_set>
+#include <vector>
+
+#include "flat_layout_scraper.hh"
+
+namespace cheri {
+
+/**
+ * Metric used to rank layouts in the top-N mode.
+ */
+enum class LayoutMetric {
+  // Total padding bytes, including nested padding
+  Padding = 1,
+  // Number of members with imprecise bounds
+  Imprecise = 2,
+  // Layout size
+  Size = 3,
+};
+
+std::optional<LayoutMetric> parseLayoutMetric(const std::string &name);
+
+/**
+ * Summary of a layout ranked by the top-N mode.
+ */
+struct RankedLayout {
+  RankedLayout() : line(0), size(0), score(0) {}
+
+  using Key = std::tuple<std::string, std::string, unsigned long long,
+                         unsigned long long, std::string>;
+  Key key() const { return std::make_tuple(name, file, line, size, binary); }
+
+  std::string name;
+  std::string file;
+  unsigned long long line;
+  unsigned long long size;
+  unsigned long long score;
+  std::string binary;
+};
+
+struct RankedLayoutHash {
+  std::size_t operator()(const RankedLayout::Key &k) const noexcept;
+};
+
+/**
+ * Bounded min-heap of the layouts with the highest score.
+ *
+ * Once the heap is full, a layout is only admitted if it scores higher
+ * than the lowest entry. The same layout found in multiple compilation
+ * units or jobs has the same key (name, file, line, size, binary), and
+ * the set of keys in the heap keeps it from being added twice.
+ */
+class TopLayouts {
+public:
+  TopLayouts(size_t limit, LayoutMetric metric)
+      : limit_(limit), metric_(metric) {}
+
+  size_t limit() const { return limit_; }
+  LayoutMetric metric() const { return metric_; }
+
+  /**
+   * Compute the score of a layout for the selected metric.
+   */
+  unsigned long long score(const FlattenedLayout &layout) const;
+
+  void push(RankedLayout entry);
+
+  /**
+   * Add the entries from another heap.
+   */
+  void merge(const TopLayouts &other);
+
+  /**
+   * Return the entries sorted by decreasing score.
+   */
+  std::vector<RankedLayout> sorted() const;
+
+private:
+  size_t limit_;
+  LayoutMetric metric_;
+  std::vector<RankedLayout> heap_;
+  std::unordered_set<RankedLayout::Key, RankedLayoutHash> in_heap_;
+};
+
+/**
+ * Top-N heap shared between the scraper jobs.
+ * Each job ranks layouts in a private heap and merges it here at the end.
+ */
+class SharedTopLayouts {
+public:
+  SharedTopLayouts(size_t limit, LayoutMetric metric) : top_(limit, metric) {}
+
+  size_t limit() const { return top_.limit(); }
+  LayoutMetric metric() const { return top_.metric(); }
+
+  void merge(const TopLayouts &other) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    top_.merge(other);
+  }
+
+  std::vector<RankedLayout> sorted() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return top_.sorted();
+  }
+
+private:
+  std::mutex mutex_;
+  TopLayouts top_;
+};
+
+/**
+ * Write a human-readable top-N report.
+ */
+void writeTopReport(std::ostream &os, const std::vector<RankedLayout> &top,
+                    LayoutMetric metric);
+
+} /* namespace cheri */
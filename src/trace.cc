@@ -0,0 +1,175 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Alfredo Mazzinghi
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+#include <format>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "trace.hh"
+
+namespace {
+
+using cheri::Tracer;
+
+struct TraceEvent {
+  std::string_view name;
+  std::string detail;
+  Tracer::Clock::time_point start;
+  Tracer::Clock::time_point end;
+};
+
+/*
+ * Spans of a single thread, only the owner thread appends to it.
+ */
+struct ThreadBuffer {
+  explicit ThreadBuffer(unsigned long tid) : tid(tid) {}
+
+  unsigned long tid;
+  std::string name;
+  std::vector<TraceEvent> events;
+};
+
+Tracer::Clock::time_point trace_start;
+std::mutex registry_mutex;
+// The buffers outlive the threads, as pool threads may expire before
+// the trace is written.
+std::vector<std::unique_ptr<ThreadBuffer>> registry;
+thread_local ThreadBuffer *thread_buffer = nullptr;
+
+ThreadBuffer &threadBuffer() {
+  if (thread_buffer == nullptr) {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    registry.emplace_back(std::make_unique<ThreadBuffer>(registry.size() + 1));
+    thread_buffer = registry.back().get();
+  }
+  return *thread_buffer;
+}
+
+std::string escapeJSON(std::string_view str) {
+  std::string out;
+  out.reserve(str.size());
+  for (char c : str) {
+    switch (c) {
+    case '"':
+      out += "\\\"";
+      break;
+    case '\\':
+      out += "\\\\";
+      break;
+    case '\n':
+      out += "\\n";
+      break;
+    case '\t':
+      out += "\\t";
+      break;
+    default:
+      if (static_cast<unsigned char>(c) < 0x20)
+        out += std::format("\\u{:04x}", c);
+      else
+        out += c;
+    }
+  }
+  return out;
+}
+
+/* Microseconds since the trace start */
+double traceTime(Tracer::Clock::time_point t) {
+  std::chrono::duration<double, std::micro> us = t - trace_start;
+  return us.count();
+}
+
+} // namespace
+
+namespace cheri {
+
+std::atomic<bool> Tracer::enabled_{false};
+
+void Tracer::enable() {
+  trace_start = Clock::now();
+  enabled_.store(true, std::memory_order_release);
+}
+
+void Tracer::record(std::string_view name, std::string detail,
+                    Clock::time_point start, Clock::time_point end) {
+  threadBuffer().events.emplace_back(
+      TraceEvent{name, std::move(detail), start, end});
+}
+
+void Tracer::nameThread(std::string_view name) {
+  if (!enabled())
+    return;
+  auto &buffer = threadBuffer();
+  if (buffer.name.empty())
+    buffer.name = name;
+}
+
+void Tracer::write(std::ostream &os) {
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  bool first = true;
+  auto separator = [&os, &first]() {
+    if (!first)
+      os << ",";
+    first = false;
+    os << "\n";
+  };
+  for (auto &buffer : registry) {
+    std::string name = buffer->name;
+    if (name.empty())
+      name = std::format("thread {}", buffer->tid);
+    separator();
+    os << std::format("{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                      "\"tid\":{},\"args\":{{\"name\":\"{}\"}}}}",
+                      buffer->tid, escapeJSON(name));
+    for (auto &event : buffer->events) {
+      separator();
+      os << std::format("{{\"name\":\"{}\",\"cat\":\"scraper\",\"ph\":\"X\","
+                        "\"pid\":1,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}",
+                        event.name, buffer->tid, traceTime(event.start),
+                        traceTime(event.end) - traceTime(event.start));
+      if (!event.detail.empty())
+        os << std::format(",\"args\":{{\"detail\":\"{}\"}}",
+                          escapeJSON(event.detail));
+      os << "}";
+    }
+  }
+  os << "\n]}\n";
+}
+
+void Tracer::reset() {
+  enabled_.store(false, std::memory_order_release);
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  // Keep the buffers, other threads may still point to them
+  for (auto &buffer : registry) {
+    buffer->name.clear();
+    buffer->events.clear();
+  }
+}
+
+} /* namespace cheri */
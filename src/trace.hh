@@ -0,0 +1,115 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Alfredo Mazzinghi
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+namespace cheri {
+
+/**
+ * Process-wide recorder of per-thread spans, exported in the Chrome
+ * trace event format so that it can be loaded in Perfetto.
+ *
+ * Each thread appends to its own buffer without locking, the registry
+ * lock is only taken the first time a thread records a span.
+ * The buffers are read by write(), which must only be called when the
+ * other threads are not recording, e.g. after the thread pool is done.
+ */
+class Tracer {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  /**
+   * Start recording spans. This must be called before the worker
+   * threads start.
+   */
+  static void enable();
+  static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+
+  /**
+   * Record a span on the calling thread.
+   * The name must have static storage duration, e.g. a string literal.
+   */
+  static void record(std::string_view name, std::string detail,
+                     Clock::time_point start, Clock::time_point end);
+
+  /**
+   * Set the name of the calling thread in the trace, if not set already.
+   */
+  static void nameThread(std::string_view name);
+
+  /**
+   * Write the recorded spans as Chrome trace event JSON.
+   */
+  static void write(std::ostream &os);
+
+  /**
+   * Drop the recorded spans and stop recording.
+   */
+  static void reset();
+
+private:
+  static std::atomic<bool> enabled_;
+};
+
+/**
+ * Scoped span for the tracer, this does nothing if tracing is disabled.
+ * The name must have static storage duration, the detail is copied
+ * and shows in the span arguments.
+ */
+class TraceScope {
+public:
+  explicit TraceScope(std::string_view name, std::string_view detail = {})
+      : active_(Tracer::enabled()) {
+    if (active_) {
+      name_ = name;
+      detail_ = detail;
+      start_ = Tracer::Clock::now();
+    }
+  }
+  TraceScope(const TraceScope &other) = delete;
+  TraceScope &operator=(const TraceScope &other) = delete;
+
+  ~TraceScope() {
+    if (active_)
+      Tracer::record(name_, std::move(detail_), start_, Tracer::Clock::now());
+  }
+
+private:
+  bool active_;
+  std::string_view name_;
+  std::string detail_;
+  Tracer::Clock::time_point start_;
+};
+
+} /* namespace cheri */
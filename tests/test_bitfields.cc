@@ -341,6 +341,7 @@ TEST_F(TestStorage, NestedBitfield) {
 
   EXPECT_TRUE(q_nbf.seek(1));
   EXPECT_EQ(q_nbf.value("name").toString(), "nested_bitfield_struct::b");
+  EXPECT_EQ(q_nbf.value("depth").toULongLong(), 0);
   EXPECT_EQ(q_nbf.value("bit_size").toULongLong(), 0);
   EXPECT_EQ(q_nbf.value("byte_size").toULongLong(), 4);
   EXPECT_EQ(q_nbf.value("bit_offset").toULongLong(), 0);
@@ -352,6 +353,7 @@ TEST_F(TestStorage, NestedBitfield) {
 
   EXPECT_TRUE(q_nbf.seek(2));
   EXPECT_EQ(q_nbf.value("name").toString(), "nested_bitfield_struct::b::a");
+  EXPECT_EQ(q_nbf.value("depth").toULongLong(), 1);
   EXPECT_EQ(q_nbf.value("bit_size").toULongLong(), 3);
   EXPECT_EQ(q_nbf.value("byte_size").toULongLong(), 4);
   EXPECT_EQ(q_nbf.value("bit_offset").toULongLong(), 0);
@@ -0,0 +1,352 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Alfredo Mazzinghi
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+#include <algorithm>
+#include <filesystem>
+#include <sstream>
+
+#include <QSqlDatabase>
+#include <QSqlQuery>
+
+#include "dwarf_corpus.hh"
+#include "fixture.hh"
+#include "layout_compare.hh"
+#include "layout_index.hh"
+#include "layout_snapshot.hh"
+
+using namespace cheri;
+
+namespace {
+
+/**
+ * Dump the scanned in-memory database to a file that can be opened
+ * by a LayoutSnapshot.
+ */
+std::filesystem::path dumpDatabase(StorageManager &sm, std::string name) {
+  auto path = std::filesystem::temp_directory_path() / name;
+  std::filesystem::remove(path);
+  sm.query("VACUUM INTO '" + path.string() + "'");
+  return path;
+}
+
+void execOn(std::filesystem::path db_path, const QString &expr) {
+  {
+    auto db = QSqlDatabase::addDatabase("QSQLITE", "test-modify");
+    db.setDatabaseName(QString::fromStdString(db_path));
+    ASSERT_TRUE(db.open());
+    QSqlQuery q(db);
+    ASSERT_TRUE(q.exec(expr));
+    db.close();
+  }
+  QSqlDatabase::removeDatabase("test-modify");
+}
+
+} // namespace
+
+TEST_F(TestStorage, CompareIdentical) {
+  std::filesystem::path src("assets/sample_padding");
+  auto scraper = setupScraper(src);
+
+  auto result = execScraper(scraper.get());
+  EXPECT_EQ(result.errors.size(), 0);
+
+  auto db_path = dumpDatabase(*sm_, "test-compare-identical.sqlite");
+  LayoutSnapshot base(db_path);
+  LayoutSnapshot other(db_path);
+  LayoutComparator comparator(base, other);
+  auto deltas = comparator.compare();
+  EXPECT_EQ(deltas.size(), 0);
+  EXPECT_EQ(comparator.unmatched(), 0);
+}
+
+TEST_F(TestStorage, ComparePointerGrowth) {
+  std::filesystem::path src("assets/sample_padding");
+  auto scraper = setupScraper(src);
+
+  auto result = execScraper(scraper.get());
+  EXPECT_EQ(result.errors.size(), 0);
+
+  auto base_path = dumpDatabase(*sm_, "test-compare-base.sqlite");
+  auto other_path = dumpDatabase(*sm_, "test-compare-other.sqlite");
+  // Simulate a pointer growing by 16 bytes
+  execOn(other_path, "UPDATE type_layout SET size = 64, total_padding = 32 "
+                     "WHERE name = 'pointer_padding'");
+  execOn(other_path, "UPDATE layout_member SET byte_size = 32 "
+                     "WHERE name = 'pointer_padding::p'");
+
+  LayoutSnapshot base(base_path);
+  LayoutSnapshot other(other_path);
+  LayoutComparator comparator(base, other);
+  auto deltas = comparator.compare();
+  ASSERT_EQ(deltas.size(), 1);
+  EXPECT_EQ(std::get<0>(deltas[0].id), "pointer_padding");
+  EXPECT_EQ(deltas[0].base_size, 48);
+  EXPECT_EQ(deltas[0].other_size, 64);
+  EXPECT_EQ(deltas[0].size_delta, 16);
+  EXPECT_EQ(deltas[0].padding_delta, 2);
+  ASSERT_EQ(deltas[0].members.size(), 1);
+  EXPECT_EQ(deltas[0].members[0].name, "pointer_padding::p");
+  EXPECT_EQ(deltas[0].members[0].base_size, 16);
+  EXPECT_EQ(deltas[0].members[0].other_size, 32);
+  EXPECT_TRUE(deltas[0].members[0].is_pointer);
+  // Only the members of the changed layouts are loaded
+  for (auto &layout : base.layouts()) {
+    EXPECT_EQ(layout.members.empty(), layout.name != "pointer_padding")
+        << layout.name;
+  }
+
+  std::ostringstream report;
+  writeCompareReport(report, deltas);
+  EXPECT_NE(report.str().find("pointer_padding::p 0x10 -> 0x20 (pointer)"),
+            std::string::npos);
+}
+
+TEST_F(TestStorage, LayoutFingerprint) {
+  std::filesystem::path src("assets/sample_padding");
+  auto scraper = setupScraper(src);
+
+  auto result = execScraper(scraper.get());
+  EXPECT_EQ(result.errors.size(), 0);
+
+  auto q = sm_->query("SELECT name, fingerprint FROM type_layout "
+                      "WHERE name IN ('padded_struct', 'no_padding_struct') "
+                      "ORDER BY name");
+  EXPECT_FALSE(q.lastError().isValid());
+  EXPECT_EQ(selectedRows(q), 2);
+  EXPECT_TRUE(q.seek(0));
+  auto fp_no_padding = q.value("fingerprint").toString();
+  EXPECT_EQ(fp_no_padding.size(), 32);
+  EXPECT_TRUE(q.seek(1));
+  auto fp_padded = q.value("fingerprint").toString();
+  EXPECT_EQ(fp_padded.size(), 32);
+  EXPECT_NE(fp_no_padding, fp_padded);
+}
+
+TEST_F(TestStorage, DiffChangedMember) {
+  std::filesystem::path src("assets/sample_padding");
+  auto scraper = setupScraper(src);
+
+  auto result = execScraper(scraper.get());
+  EXPECT_EQ(result.errors.size(), 0);
+
+  auto base_path = dumpDatabase(*sm_, "test-diff-base.sqlite");
+  auto other_path = dumpDatabase(*sm_, "test-diff-other.sqlite");
+  execOn(other_path, "UPDATE type_layout SET fingerprint = 'changed' "
+                     "WHERE name = 'padded_struct'");
+  execOn(other_path, "UPDATE layout_member SET byte_offset = 9 "
+                     "WHERE name = 'padded_struct::c'");
+  execOn(other_path, "DELETE FROM layout_member "
+                     "WHERE name = 'padded_struct::a'");
+  // A change that only the fingerprint sees is still reported
+  execOn(other_path, "UPDATE type_layout SET fingerprint = 'changed' "
+                     "WHERE name = 'pointer_padding'");
+  execOn(other_path, "UPDATE layout_member SET is_pointer = 0 "
+                     "WHERE name = 'pointer_padding::p'");
+
+  LayoutSnapshot base(base_path);
+  LayoutSnapshot other(other_path);
+  LayoutDiffer differ(base, other);
+  auto diffs = differ.diff();
+  ASSERT_EQ(diffs.size(), 2);
+  auto find_diff = [&diffs](const std::string &name) {
+    auto it = std::find_if(diffs.begin(), diffs.end(), [&](auto &diff) {
+      return std::get<0>(diff.id) == name;
+    });
+    return it == diffs.end() ? nullptr : &*it;
+  };
+
+  auto *padded = find_diff("padded_struct");
+  ASSERT_NE(padded, nullptr);
+  EXPECT_EQ(padded->kind, DiffKind::Changed);
+  ASSERT_EQ(padded->members.size(), 2);
+  EXPECT_EQ(padded->members[0].kind, DiffKind::Changed);
+  EXPECT_EQ(padded->members[0].base->name, "padded_struct::c");
+  EXPECT_EQ(padded->members[0].base->byte_offset, 8);
+  EXPECT_EQ(padded->members[0].other->byte_offset, 9);
+  EXPECT_EQ(padded->members[1].kind, DiffKind::Removed);
+  EXPECT_EQ(padded->members[1].base->name, "padded_struct::a");
+  EXPECT_FALSE(padded->members[1].other);
+
+  auto *pointer = find_diff("pointer_padding");
+  ASSERT_NE(pointer, nullptr);
+  ASSERT_EQ(pointer->members.size(), 1);
+  EXPECT_EQ(pointer->members[0].kind, DiffKind::Changed);
+  EXPECT_TRUE(pointer->members[0].base->is_pointer);
+  EXPECT_FALSE(pointer->members[0].other->is_pointer);
+  EXPECT_GT(differ.unchanged(), 0);
+}
+
+TEST_F(TestStorage, ODRConflictAcrossBinaries) {
+  std::filesystem::path src("assets/sample_padding");
+  auto scraper = std::make_unique<FlatLayoutScraper>(
+      *sm_, std::make_unique<DwarfSource>(src));
+  scraper->setODRCheck(true);
+
+  auto result = execScraper(scraper.get());
+  EXPECT_EQ(result.errors.size(), 0);
+
+  {
+    auto q_conflict = sm_->query("SELECT * FROM odr_conflict");
+    EXPECT_FALSE(q_conflict.lastError().isValid());
+    EXPECT_EQ(selectedRows(q_conflict), 0);
+  }
+
+  // Simulate a different definition of pointer_padding in another binary
+  sm_->query("INSERT INTO binary (id, file, pointer_size, cap_size) "
+             "SELECT 1000, 'other', pointer_size, cap_size FROM binary");
+  sm_->query("INSERT INTO type_layout (binary_id, name, file, line, size, "
+             "is_union, has_vla, total_padding, tail_padding, holes, "
+             "nested_padding, nested_holes, has_extra_padding, fingerprint) "
+             "SELECT 1000, name, file, line, 64, is_union, has_vla, "
+             "total_padding, tail_padding, holes, nested_padding, "
+             "nested_holes, has_extra_padding, 'other' "
+             "FROM type_layout WHERE name = 'pointer_padding'");
+  // A hybrid build of the same definition has a different layout, but it
+  // is not a conflict because the ABI differs.
+  sm_->query("INSERT INTO binary (id, file, pointer_size, cap_size) "
+             "SELECT 1001, 'other-hybrid', 8, cap_size FROM binary "
+             "WHERE id = 1000");
+  sm_->query("INSERT INTO type_layout (binary_id, name, file, line, size, "
+             "is_union, has_vla, total_padding, tail_padding, holes, "
+             "nested_padding, nested_holes, has_extra_padding, fingerprint) "
+             "SELECT 1001, name, file, line, 24, is_union, has_vla, "
+             "total_padding, tail_padding, holes, nested_padding, "
+             "nested_holes, has_extra_padding, 'hybrid' "
+             "FROM type_layout WHERE name = 'pointer_padding' "
+             "AND binary_id = 1000");
+
+  auto rescan = std::make_unique<FlatLayoutScraper>(
+      *sm_, std::make_unique<DwarfSource>(src));
+  rescan->setODRCheck(true);
+  result = execScraper(rescan.get());
+  EXPECT_EQ(result.errors.size(), 0);
+
+  auto q_conflict = sm_->query("SELECT * FROM odr_conflict");
+  EXPECT_FALSE(q_conflict.lastError().isValid());
+  ASSERT_EQ(selectedRows(q_conflict), 1);
+  EXPECT_TRUE(q_conflict.seek(0));
+  EXPECT_EQ(q_conflict.value("name").toString(), "pointer_padding");
+  EXPECT_EQ(q_conflict.value("size").toULongLong(), 48);
+  EXPECT_EQ(q_conflict.value("other_binary_id").toULongLong(), 1000);
+  EXPECT_EQ(q_conflict.value("other_size").toULongLong(), 64);
+  EXPECT_TRUE(q_conflict.value("other_unit").isNull());
+}
+
+TEST_F(TestStorage, ODRConflictWithinBinary) {
+  // Both units define shared0 at the same location with the same size,
+  // but with different member names.
+  CorpusConfig config;
+  config.units = 2;
+  config.structs = 2;
+  config.members = 4;
+  config.conflicts = 1;
+  auto path = std::filesystem::temp_directory_path() / "test_odr_corpus.elf";
+  {
+    std::error_code ec;
+    llvm::raw_fd_ostream os(path.string(), ec);
+    ASSERT_FALSE(ec);
+    generateCorpus(config, os);
+  }
+
+  auto scraper = std::make_unique<FlatLayoutScraper>(
+      *sm_, std::make_unique<DwarfSource>(path));
+  scraper->setODRCheck(true);
+  auto result = execScraper(scraper.get());
+  EXPECT_EQ(result.errors.size(), 0);
+  // The conflicting definition is neither recorded nor a duplicate
+  EXPECT_EQ(result.layouts, 3);
+  EXPECT_EQ(result.dup_structs, 0);
+  EXPECT_EQ(result.dup_members, 0);
+
+  auto q_conflict = sm_->query("SELECT * FROM odr_conflict");
+  EXPECT_FALSE(q_conflict.lastError().isValid());
+  ASSERT_EQ(selectedRows(q_conflict), 1);
+  EXPECT_TRUE(q_conflict.seek(0));
+  EXPECT_EQ(q_conflict.value("name").toString(), "shared0");
+  EXPECT_EQ(q_conflict.value("size").toULongLong(),
+            q_conflict.value("other_size").toULongLong());
+  EXPECT_FALSE(q_conflict.value("other_unit").isNull());
+
+  // The first definition is recorded, without members of the second one
+  auto q_layout = sm_->query("SELECT * FROM type_layout "
+                             "WHERE name = 'shared0'");
+  ASSERT_EQ(selectedRows(q_layout), 1);
+  auto q_members = sm_->query(
+      "SELECT m.name FROM layout_member m "
+      "JOIN type_layout l ON m.owner = l.id WHERE l.name = 'shared0'");
+  EXPECT_FALSE(q_members.lastError().isValid());
+  ASSERT_EQ(selectedRows(q_members), 4);
+  while (q_members.next()) {
+    EXPECT_TRUE(q_members.value(0).toString().contains("u0_m"))
+        << q_members.value(0).toString().toStdString();
+  }
+
+  std::filesystem::remove(path);
+}
+
+TEST_F(TestStorage, AnnotateMemberOffsets) {
+  std::filesystem::path src("assets/sample_padding");
+  auto scraper = setupScraper(src);
+
+  auto result = execScraper(scraper.get());
+  EXPECT_EQ(result.errors.size(), 0);
+
+  auto db_path = dumpDatabase(*sm_, "test-annotate.sqlite");
+  LayoutSnapshot snapshot(db_path);
+  snapshot.loadLayouts();
+  snapshot.loadMembers();
+  LayoutIndex index(snapshot);
+
+  auto *intervals = index.find("parent_padding");
+  ASSERT_NE(intervals, nullptr);
+  // Padding before the nested structure
+  EXPECT_EQ(intervals->lookup(1), nullptr);
+  auto *member = intervals->lookup(20);
+  ASSERT_NE(member, nullptr);
+  EXPECT_EQ(member->name, "parent_padding::inner::p");
+  EXPECT_EQ(member->depth, 1);
+  // Tail padding of the nested structure
+  member = intervals->lookup(40);
+  ASSERT_NE(member, nullptr);
+  EXPECT_EQ(member->name, "parent_padding::inner");
+  EXPECT_EQ(member->depth, 0);
+  member = intervals->lookup(48);
+  ASSERT_NE(member, nullptr);
+  EXPECT_EQ(member->name, "parent_padding::d");
+  EXPECT_EQ(intervals->lookup(64), nullptr);
+
+  std::istringstream trace("parent_padding 0x20\n"
+                           "missing_type 0\n"
+                           "parent_padding 1\n");
+  std::ostringstream annotated;
+  EXPECT_EQ(annotateRecords(trace, annotated, index, /*batch_size=*/2), 3);
+  EXPECT_EQ(annotated.str(),
+            "parent_padding 0x20 parent_padding::inner::b 1 0\n"
+            "missing_type 0x0 ? - -\n"
+            "parent_padding 0x1 - - -\n");
+}
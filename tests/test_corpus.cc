@@ -0,0 +1,77 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Alfredo Mazzinghi
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+#include <filesystem>
+
+#include "dwarf_corpus.hh"
+#include "fixture.hh"
+#include "global_sym_scraper.hh"
+
+using namespace cheri;
+
+TEST_F(TestStorage, GeneratedCorpus) {
+  CorpusConfig config;
+  config.units = 3;
+  config.structs = 8;
+  config.bitfields = 2;
+  config.vlas = 1;
+  config.globals = 4;
+
+  auto path = std::filesystem::temp_directory_path() / "test_corpus.elf";
+  CorpusSummary summary;
+  {
+    std::error_code ec;
+    llvm::raw_fd_ostream os(path.string(), ec);
+    ASSERT_FALSE(ec);
+    summary = generateCorpus(config, os);
+  }
+  EXPECT_EQ(summary.format, CapFormat::RISCV128);
+  EXPECT_EQ(summary.layouts, 24);
+  EXPECT_EQ(summary.globals, 12);
+
+  auto scraper = setupScraper(path);
+  EXPECT_EQ(scraper->source().getABIPointerSize(), 16);
+  EXPECT_EQ(scraper->source().getCapFormat(), summary.format);
+  EXPECT_EQ(scraper->source().findRepresentablePadding(0x1001),
+            findRepresentablePadding(summary.format, 0x1001));
+  auto result = execScraper(scraper.get());
+  EXPECT_EQ(result.errors.size(), 0);
+  EXPECT_EQ(result.layouts, summary.layouts);
+
+  auto q = sm_->query("SELECT * FROM type_layout WHERE has_vla = 1");
+  EXPECT_FALSE(q.lastError().isValid());
+  EXPECT_EQ(selectedRows(q), 3);
+
+  auto global_scraper = std::make_unique<GlobalSymScraper>(
+      *sm_, std::make_unique<DwarfSource>(path));
+  auto global_result = execScraper(global_scraper.get());
+  EXPECT_EQ(global_result.errors.size(), 0);
+  EXPECT_EQ(global_result.globals, summary.globals);
+
+  std::filesystem::remove(path);
+}
@@ -0,0 +1,297 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Alfredo Mazzinghi
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+#include <filesystem>
+#include <sstream>
+
+#include <QSqlQuery>
+
+#include "dwarf_corpus.hh"
+#include "fixture.hh"
+#include "global_placement.hh"
+#include "global_sym_scraper.hh"
+#include "layout_snapshot.hh"
+
+using namespace cheri;
+
+TEST(GlobalExposure, SortedSweep) {
+  std::vector<SymbolExtent> symbols = {
+      // Precise, but overlapping with the imprecise symbol below
+      {0x2000, 0x10, 0x2000, 0x2010},
+      // Imprecise, bounds grow to [0x1000, 0x3000)
+      {0x1010, 0x1fe0, 0x1000, 0x3000},
+      // Large precise symbol ending inside the imprecise bounds
+      {0x0, 0x1008, 0x0, 0x1008},
+      // Precise, outside of the imprecise bounds
+      {0x3000, 0x8, 0x3000, 0x3008},
+  };
+
+  auto exposures = findExposures(symbols);
+  ASSERT_EQ(exposures.size(), 2);
+  std::sort(exposures.begin(), exposures.end(),
+            [](auto &l, auto &r) { return l.neighbor < r.neighbor; });
+  EXPECT_EQ(exposures[0].sym, 1);
+  EXPECT_EQ(exposures[0].neighbor, 0);
+  EXPECT_EQ(exposures[0].base, 0x2000);
+  EXPECT_EQ(exposures[0].top, 0x2010);
+  EXPECT_EQ(exposures[1].sym, 1);
+  EXPECT_EQ(exposures[1].neighbor, 2);
+  EXPECT_EQ(exposures[1].base, 0x1000);
+  EXPECT_EQ(exposures[1].top, 0x1008);
+}
+
+TEST(GlobalOverhead, SectionSimulation) {
+  std::vector<SectionInfo> sections = {
+      {".data", 0x1000, 0x1000, false},
+      {".bss", 0x3000, 0x100000, true},
+  };
+  std::vector<GlobalSymInfo> symbols(4);
+  // Precise
+  symbols[0].addr = 0x1000;
+  symbols[0].size = symbols[0].padded_size = 8;
+  symbols[0].required_align = 1;
+  // Needs 7 bytes of padding, the shift is rounded to 16 bytes
+  symbols[1].addr = 0x1008;
+  symbols[1].size = 0x1001;
+  symbols[1].padded_size = 0x1008;
+  symbols[1].required_align = 8;
+  // Exact length, but misaligned
+  symbols[2].addr = 0x3010;
+  symbols[2].size = symbols[2].padded_size = 0x10000;
+  symbols[2].required_align = 0x20;
+  // Precise, after the misaligned symbol
+  symbols[3].addr = 0x13010;
+  symbols[3].size = symbols[3].padded_size = 4;
+  symbols[3].required_align = 1;
+
+  std::vector<const GlobalSymInfo *> input;
+  for (auto &sym : symbols)
+    input.push_back(&sym);
+  auto overhead = estimateSectionOverhead(sections, input, /*granule=*/16);
+  ASSERT_EQ(overhead.size(), 2);
+  EXPECT_EQ(overhead[0].section, ".data");
+  EXPECT_EQ(overhead[0].imprecise_syms, 1);
+  EXPECT_EQ(overhead[0].pad_bytes, 7);
+  EXPECT_EQ(overhead[0].align_bytes, 9);
+  EXPECT_EQ(overhead[0].growth(), 16);
+  EXPECT_EQ(overhead[1].section, ".bss");
+  EXPECT_EQ(overhead[1].imprecise_syms, 1);
+  EXPECT_EQ(overhead[1].pad_bytes, 0);
+  EXPECT_EQ(overhead[1].growth(), 16);
+}
+
+TEST(GlobalPlacement, PackByAlignment) {
+  EXPECT_EQ(estimateNaturalAlign(0x1001, 16), 1);
+  EXPECT_EQ(estimateNaturalAlign(0x18, 16), 8);
+  EXPECT_EQ(estimateNaturalAlign(0x4000, 16), 16);
+
+  auto make = [](std::string name, unsigned long long addr,
+                 unsigned long long size, unsigned long long padded,
+                 uint64_t align, bool is_external = true) {
+    PlacementSymbol sym;
+    sym.name = name;
+    sym.linkage_name = "_Z" + name;
+    sym.is_external = is_external;
+    sym.section = ".data";
+    sym.addr = addr;
+    sym.size = size;
+    sym.padded_size = padded;
+    sym.align = align;
+    return sym;
+  };
+  std::vector<PlacementSymbol> symbols = {
+      make("a", 0x1000, 1, 1, 1),
+      // Imprecise, padded to 0x1010 and aligned to 0x10
+      make("big", 0x1001, 0x1001, 0x1010, 0x10),
+      make("b", 0x2002, 2, 2, 2),
+      make("<anon@0x10>", 0x2004, 4, 4, 4, false),
+  };
+
+  auto placements = placeSymbols(symbols);
+  ASSERT_EQ(placements.size(), 1);
+  // a at 0, big at 0x10, b at 0x1020, anon at 0x1024
+  EXPECT_EQ(placements[0].naive_size, 0x1028);
+  // big, b, a and the local anon symbol last, at 0x1014
+  EXPECT_EQ(placements[0].placed_size, 0x1018);
+  EXPECT_EQ(placements[0].saved(), 0x10);
+  ASSERT_EQ(placements[0].order.size(), 4);
+  EXPECT_EQ(placements[0].order[0], 1);
+  EXPECT_EQ(placements[0].order[3], 3);
+
+  std::ostringstream ordering;
+  writeOrderingFile(ordering, symbols, placements);
+  EXPECT_EQ(ordering.str(), "_Zbig\n_Zb\n_Za\n");
+}
+
+TEST(GlobalPlacement, FillAlignmentHoles) {
+  auto make = [](std::string name, unsigned long long addr,
+                 unsigned long long size, uint64_t align) {
+    PlacementSymbol sym;
+    sym.name = sym.linkage_name = name;
+    sym.section = ".data";
+    sym.addr = addr;
+    sym.size = sym.padded_size = size;
+    sym.align = align;
+    sym.is_external = true;
+    return sym;
+  };
+  std::vector<PlacementSymbol> symbols = {
+      make("w", 0x1000, 2, 2),
+      make("x", 0x1010, 4, 16),
+      make("y", 0x1020, 16, 16),
+      make("z", 0x1030, 8, 8),
+  };
+
+  auto placements = placeSymbols(symbols);
+  ASSERT_EQ(placements.size(), 1);
+  // y at 0, x at 0x10, z at 0x18 leaves a hole at 0x14 that holds w
+  EXPECT_EQ(placements[0].placed_size, 0x20);
+  std::ostringstream ordering;
+  writeOrderingFile(ordering, symbols, placements);
+  EXPECT_EQ(ordering.str(), "y\nx\nw\nz\n");
+}
+
+TEST_F(TestStorage, GlobalSymAddress) {
+  std::filesystem::path src("assets/sample_imprecise_member");
+  auto scraper = std::make_unique<GlobalSymScraper>(
+      *sm_, std::make_unique<DwarfSource>(src));
+
+  auto result = execScraper(scraper.get());
+  EXPECT_EQ(result.errors.size(), 0);
+
+  auto q = sm_->query("SELECT g.*, b.file AS binary FROM global_sym g "
+                      "JOIN binary b ON g.binary_id = b.id WHERE g.name = 'x'");
+  EXPECT_FALSE(q.lastError().isValid());
+  ASSERT_EQ(selectedRows(q), 1);
+  EXPECT_TRUE(q.seek(0));
+  EXPECT_NE(q.value("addr").toULongLong(), 0);
+  EXPECT_EQ(q.value("size").toULongLong(), 0x8002);
+  EXPECT_EQ(q.value("binary").toString(), "assets/sample_imprecise_member");
+  EXPECT_FALSE(q.value("section").isNull());
+  // C symbols have no separate linkage name
+  EXPECT_TRUE(q.value("linkage_name").isNull());
+  EXPECT_TRUE(q.value("is_external").toBool());
+
+  // Exact bounds need 0x40 alignment and a 0x8040 length
+  EXPECT_EQ(q.value("required_align").toULongLong(), 0x40);
+  EXPECT_EQ(q.value("padded_size").toULongLong(), 0x8040);
+  EXPECT_TRUE(q.value("is_imprecise").toBool());
+
+  // x is aligned and the rounded top only reaches the end of .bss, where
+  // no other symbol lives, so nothing is exposed.
+  auto q_exposure = sm_->query("SELECT * FROM global_sym_exposure");
+  EXPECT_FALSE(q_exposure.lastError().isValid());
+  EXPECT_EQ(selectedRows(q_exposure), 0);
+
+  // Only .bss holds an imprecise symbol, padding x grows it by 0x3e bytes
+  // rounded to the capability size.
+  auto q_overhead = sm_->query("SELECT * FROM global_section_overhead");
+  EXPECT_FALSE(q_overhead.lastError().isValid());
+  ASSERT_EQ(selectedRows(q_overhead), 1);
+  EXPECT_TRUE(q_overhead.seek(0));
+  EXPECT_EQ(q_overhead.value("section").toString(),
+            q.value("section").toString());
+  EXPECT_EQ(q_overhead.value("section").toString(), ".bss");
+  EXPECT_EQ(q_overhead.value("section_addr").toULongLong(), 0x3a80);
+  EXPECT_EQ(q_overhead.value("section_size").toULongLong(), 0x8080);
+  EXPECT_EQ(q_overhead.value("imprecise_syms").toULongLong(), 1);
+  EXPECT_EQ(q_overhead.value("pad_bytes").toULongLong(), 0x3e);
+  EXPECT_EQ(q_overhead.value("align_bytes").toULongLong(), 2);
+  EXPECT_EQ(q_overhead.value("growth").toULongLong(), 0x40);
+}
+
+TEST_F(TestStorage, GlobalSymInstances) {
+  std::filesystem::path src("assets/sample_imprecise_member");
+  auto layout_scraper = setupScraper(src);
+  auto layout_result = execScraper(layout_scraper.get());
+  EXPECT_EQ(layout_result.errors.size(), 0);
+
+  auto scraper = std::make_unique<GlobalSymScraper>(
+      *sm_, std::make_unique<DwarfSource>(src));
+  auto result = execScraper(scraper.get());
+  EXPECT_EQ(result.errors.size(), 0);
+
+  auto q_sym = sm_->query("SELECT * FROM global_sym WHERE name = 'x'");
+  EXPECT_FALSE(q_sym.lastError().isValid());
+  ASSERT_EQ(selectedRows(q_sym), 1);
+  EXPECT_TRUE(q_sym.seek(0));
+  EXPECT_EQ(q_sym.value("type_name").toString(), "foo");
+  EXPECT_FALSE(q_sym.value("type_file").isNull());
+  EXPECT_EQ(q_sym.value("instances").toULongLong(), 1);
+
+  auto q = sm_->query("SELECT * FROM layout_static_instances "
+                      "WHERE name = 'foo'");
+  EXPECT_FALSE(q.lastError().isValid());
+  ASSERT_EQ(selectedRows(q), 1);
+  EXPECT_TRUE(q.seek(0));
+  EXPECT_EQ(q.value("globals").toULongLong(), 1);
+  EXPECT_EQ(q.value("instances").toULongLong(), 1);
+  EXPECT_EQ(q.value("static_bytes").toULongLong(), 0x8002);
+  EXPECT_EQ(q.value("imprecise_members").toULongLong(), 1);
+  EXPECT_GT(q.value("growth_bytes").toULongLong(), 0);
+}
+
+TEST_F(TestStorage, GlobalPlacementGranule) {
+  // 64-bit capabilities cap the natural alignment to 8 bytes
+  CorpusConfig config;
+  config.triple = "riscv32-unknown-freebsd-purecap";
+  config.structs = 4;
+  config.globals = 8;
+  auto path = std::filesystem::temp_directory_path() / "test_place_corpus.elf";
+  {
+    std::error_code ec;
+    llvm::raw_fd_ostream os(path.string(), ec);
+    ASSERT_FALSE(ec);
+    generateCorpus(config, os);
+  }
+
+  auto scraper = std::make_unique<GlobalSymScraper>(
+      *sm_, std::make_unique<DwarfSource>(path));
+  auto result = execScraper(scraper.get());
+  EXPECT_EQ(result.errors.size(), 0);
+
+  auto db_path =
+      std::filesystem::temp_directory_path() / "test-place-granule.sqlite";
+  std::filesystem::remove(db_path);
+  sm_->query("VACUUM INTO '" + db_path.string() + "'");
+
+  LayoutSnapshot snapshot(db_path);
+  auto symbols = loadPlacementSymbols(snapshot, std::nullopt);
+  ASSERT_EQ(symbols.size(), config.globals);
+  for (auto &sym : symbols) {
+    auto q = sm_->query("SELECT required_align FROM global_sym "
+                        "WHERE name = '" + sym.name + "'");
+    ASSERT_TRUE(q.first());
+    EXPECT_EQ(sym.align,
+              std::max<uint64_t>(q.value(0).toULongLong(),
+                                 estimateNaturalAlign(sym.size, 8)))
+        << sym.name;
+  }
+
+  std::filesystem::remove(path);
+}
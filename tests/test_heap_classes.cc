@@ -0,0 +1,114 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Alfredo Mazzinghi
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+#include <algorithm>
+#include <filesystem>
+#include <sstream>
+
+#include "fixture.hh"
+#include "heap_classes.hh"
+#include "layout_snapshot.hh"
+
+using namespace cheri;
+
+TEST(HeapClasses, ParseAndSelect) {
+  std::istringstream table("# jemalloc-style classes\n"
+                           "16\n"
+                           "0x30 16\n"
+                           "\n"
+                           "8  # tiny\n"
+                           "4096\n");
+  auto classes = parseSizeClasses(table, 4096);
+  ASSERT_EQ(classes.size(), 4);
+  EXPECT_EQ(classes[0].size, 8);
+  EXPECT_EQ(classes[0].align, 8);
+  EXPECT_EQ(classes[2].size, 0x30);
+  EXPECT_EQ(classes[2].align, 16);
+  EXPECT_EQ(classes[3].align, 4096);
+
+  EXPECT_EQ(selectSizeClass(classes, 16, 4096).size, 16);
+  EXPECT_EQ(selectSizeClass(classes, 17, 4096).size, 0x30);
+  // Large allocations are rounded to pages
+  auto large = selectSizeClass(classes, 5000, 4096);
+  EXPECT_EQ(large.size, 8192);
+  EXPECT_EQ(large.align, 4096);
+
+  std::istringstream bad_align("16 3\n");
+  EXPECT_THROW(parseSizeClasses(bad_align, 4096), std::runtime_error);
+  std::istringstream bad_size("1x6\n");
+  EXPECT_THROW(parseSizeClasses(bad_size, 4096), std::runtime_error);
+}
+
+TEST(HeapClasses, MemberPrecision) {
+  SnapshotMember m;
+  m.byte_size = m.padded_size = 0x4000;
+  m.byte_offset = 0x4000;
+  m.required_align = 0x20;
+  EXPECT_TRUE(isPreciseMember(m, 0x1000));
+  // The allocation base is not aligned enough
+  EXPECT_FALSE(isPreciseMember(m, 0x10));
+
+  m.byte_offset = 0x4002;
+  EXPECT_FALSE(isPreciseMember(m, 0x1000));
+
+  m.byte_offset = 0;
+  m.padded_size = 0x4020;
+  EXPECT_FALSE(isPreciseMember(m, 0x1000));
+}
+
+TEST_F(TestStorage, HeapClassImpreciseMember) {
+  std::filesystem::path src("assets/sample_imprecise_member");
+  auto scraper = setupScraper(src);
+  auto result = execScraper(scraper.get());
+  EXPECT_EQ(result.errors.size(), 0);
+
+  auto db_path =
+      std::filesystem::temp_directory_path() / "test-heap-classes.sqlite";
+  std::filesystem::remove(db_path);
+  sm_->query("VACUUM INTO '" + db_path.string() + "'");
+
+  LayoutSnapshot snapshot(db_path);
+  snapshot.loadLayouts();
+  snapshot.loadMembers();
+
+  std::vector<SizeClass> classes = {{16, 16}, {0x8000, 0x1000}};
+  auto heap = analyzeHeapClasses(snapshot.layouts(), classes,
+                                 CapFormat::RISCV128, 4096, /*workers=*/2);
+  auto it = std::find_if(heap.begin(), heap.end(),
+                         [](auto &info) { return info.name == "foo"; });
+  ASSERT_NE(it, heap.end());
+  EXPECT_EQ(it->size, 0x8002);
+  EXPECT_EQ(it->class_size, 0x9000);
+  EXPECT_EQ(it->class_align, 0x1000);
+  EXPECT_EQ(it->members, 3);
+  EXPECT_EQ(it->imprecise_members, 1);
+
+  std::ostringstream report;
+  writeHeapClassReport(report, heap);
+  EXPECT_NE(report.str().find("foo"), std::string::npos);
+}
@@ -0,0 +1,94 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Alfredo Mazzinghi
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+#include <filesystem>
+
+#include "fixture.hh"
+#include "histogram.hh"
+
+using namespace cheri;
+
+TEST(Histogram, BucketBounds) {
+  for (uint64_t value : {0ULL, 1ULL, 63ULL, 64ULL, 65ULL, 127ULL, 128ULL,
+                         1000ULL, 123456789ULL, ~0ULL}) {
+    auto index = Histogram::bucketIndex(value);
+    EXPECT_LE(Histogram::bucketLowest(index), value);
+    EXPECT_GE(Histogram::bucketHighest(index), value);
+  }
+  // Buckets are contiguous
+  for (size_t index = 1; index < 1024; index++) {
+    EXPECT_EQ(Histogram::bucketLowest(index),
+              Histogram::bucketHighest(index - 1) + 1);
+  }
+}
+
+TEST(Histogram, Percentiles) {
+  Histogram h;
+  EXPECT_EQ(h.percentile(50), 0);
+  for (uint64_t value = 1; value <= 1000; value++)
+    h.record(value);
+  EXPECT_EQ(h.count(), 1000);
+  EXPECT_EQ(h.max(), 1000);
+  // Within the bucket precision
+  EXPECT_NEAR(h.percentile(50), 500, 500 / Histogram::kSubBuckets);
+  EXPECT_NEAR(h.percentile(99), 990, 990 / Histogram::kSubBuckets);
+  EXPECT_EQ(h.percentile(100), 1000);
+
+  Histogram before = h;
+  h.record(5000);
+  auto delta = h.since(before);
+  EXPECT_EQ(delta.count(), 1);
+  EXPECT_EQ(delta.max(), 5000);
+  EXPECT_EQ(delta.percentile(50), 5000);
+
+  Histogram merged;
+  merged.merge(before);
+  merged.merge(delta);
+  EXPECT_EQ(merged.count(), h.count());
+  EXPECT_EQ(merged.percentile(50), h.percentile(50));
+}
+
+TEST_F(TestStorage, StorageStats) {
+  std::filesystem::path src("assets/sample_padding");
+  auto scraper = setupScraper(src);
+  auto result = execScraper(scraper.get());
+  EXPECT_EQ(result.errors.size(), 0);
+
+  EXPECT_EQ(result.scraper, scraper->name());
+  auto &stats = result.storage;
+  // At least one transaction for each layout
+  EXPECT_GE(stats.transaction.count(), result.layouts);
+  EXPECT_GE(stats.lock_wait.count(), stats.transaction.count());
+  EXPECT_EQ(stats.commit.count(), stats.transaction.count());
+  EXPECT_GT(stats.rows.percentile(50), 0);
+  EXPECT_EQ(stats.rows.count(), stats.transaction.count());
+  // The prepared statements of each transaction are timed as well
+  EXPECT_GT(stats.statement.count(), stats.transaction.count());
+  EXPECT_LE(stats.commit.max(), stats.transaction.max());
+  EXPECT_FALSE(formatStorageStats(stats).empty());
+}
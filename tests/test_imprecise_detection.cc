@@ -28,6 +28,7 @@
 #include <filesystem>
 
 #include "fixture.hh"
+#include "flat_layout_scraper.hh"
 #include "scraper.hh"
 
 using namespace cheri;
@@ -58,3 +59,90 @@ TEST_F(TestStorage, SimpleImpreciseMember) {
     EXPECT_TRUE(q_imprecise.value("max_vla_size").isNull());
   }
 }
+
+TEST_F(TestStorage, ImpreciseMemberFix) {
+  std::filesystem::path src("assets/sample_imprecise_member");
+  auto scraper = setupScraper(src);
+
+  auto result = execScraper(scraper.get());
+  EXPECT_EQ(result.errors.size(), 0);
+
+  {
+    auto q_imprecise =
+        sm_->query("SELECT * FROM layout_member WHERE is_imprecise = 1");
+    EXPECT_FALSE(q_imprecise.lastError().isValid());
+    EXPECT_EQ(selectedRows(q_imprecise), 1);
+    EXPECT_TRUE(q_imprecise.seek(0));
+    EXPECT_EQ(q_imprecise.value("name").toString(), "foo::hash");
+    EXPECT_EQ(q_imprecise.value("required_align").toULongLong(), 0x20);
+    EXPECT_EQ(q_imprecise.value("padded_size").toULongLong(), 0x4000);
+    // Moving foo::hash from 0x4002 to 0x4020 grows the struct to 0x8020
+    EXPECT_EQ(q_imprecise.value("layout_size_delta").toULongLong(), 0x1e);
+  }
+
+  {
+    auto q_precise =
+        sm_->query("SELECT * FROM layout_member WHERE is_imprecise = 0");
+    EXPECT_FALSE(q_precise.lastError().isValid());
+    EXPECT_EQ(selectedRows(q_precise), 2);
+    EXPECT_TRUE(q_precise.seek(0));
+    EXPECT_TRUE(q_precise.value("layout_size_delta").isNull());
+    EXPECT_TRUE(q_precise.seek(1));
+    EXPECT_TRUE(q_precise.value("layout_size_delta").isNull());
+  }
+}
+
+TEST(ArrayElements, ImpreciseElements) {
+  // All elements aligned
+  auto summary = findImpreciseElements(0x40, 0x40, 64, 0x20, true);
+  EXPECT_EQ(summary.imprecise, 0);
+  EXPECT_FALSE(summary.first_imprecise);
+
+  // Imprecise length, every element is imprecise
+  summary = findImpreciseElements(0x40, 0x40, 64, 0x20, false);
+  EXPECT_EQ(summary.imprecise, 64);
+  EXPECT_EQ(summary.first_imprecise, 0);
+
+  // Only even elements are aligned
+  summary = findImpreciseElements(0x0, 0x10, 64, 0x20, true);
+  EXPECT_EQ(summary.imprecise, 32);
+  EXPECT_EQ(summary.first_imprecise, 1);
+
+  // One element every 4 is aligned, starting from element 1
+  summary = findImpreciseElements(0x8, 0x18, 64, 0x20, true);
+  EXPECT_EQ(summary.imprecise, 48);
+  EXPECT_EQ(summary.first_imprecise, 0);
+
+  // Never aligned
+  summary = findImpreciseElements(0x8, 0x10, 64, 0x20, true);
+  EXPECT_EQ(summary.imprecise, 64);
+  EXPECT_EQ(summary.first_imprecise, 0);
+}
+
+TEST_F(TestStorage, NestedArrayElements) {
+  std::filesystem::path src("assets/sample_padding");
+  auto scraper = setupScraper(src);
+
+  auto result = execScraper(scraper.get());
+  EXPECT_EQ(result.errors.size(), 0);
+
+  auto q = sm_->query("SELECT * FROM layout_member WHERE name LIKE "
+                      "'array_of_nested::arr::%' ORDER BY name");
+  EXPECT_FALSE(q.lastError().isValid());
+  EXPECT_EQ(selectedRows(q), 2);
+  EXPECT_TRUE(q.seek(0));
+  EXPECT_EQ(q.value("name").toString(), "array_of_nested::arr::b");
+  EXPECT_EQ(q.value("imprecise_elements").toULongLong(), 0);
+  EXPECT_TRUE(q.value("first_imprecise_element").isNull());
+  EXPECT_TRUE(q.seek(1));
+  EXPECT_EQ(q.value("name").toString(), "array_of_nested::arr::p");
+  EXPECT_EQ(q.value("imprecise_elements").toULongLong(), 0);
+  EXPECT_TRUE(q.value("first_imprecise_element").isNull());
+
+  auto q_top = sm_->query("SELECT * FROM layout_member WHERE "
+                          "name = 'array_of_nested::arr'");
+  EXPECT_FALSE(q_top.lastError().isValid());
+  EXPECT_EQ(selectedRows(q_top), 1);
+  EXPECT_TRUE(q_top.seek(0));
+  EXPECT_TRUE(q_top.value("imprecise_elements").isNull());
+}
@@ -28,6 +28,7 @@
 #include "fixture.hh"
 #include "flat_layout_scraper.hh"
 #include "storage.hh"
+#include "top_layouts.hh"
 
 using namespace cheri;
 
@@ -192,6 +193,31 @@ TEST_F(TestStorage, TestArrayOfNested) {
   EXPECT_EQ(q.value("nested_holes").toULongLong(), 0);
 }
 
+TEST_F(TestStorage, TestArrayMemberAlignment) {
+  std::filesystem::path src("assets/sample_padding");
+  auto scraper = setupScraper(src);
+
+  auto result = execScraper(scraper.get());
+  EXPECT_EQ(result.errors.size(), 0);
+
+  auto q = sm_->query("SELECT name, byte_size, alignment FROM layout_member "
+                      "WHERE name IN ('array_of_nested::arr', "
+                      "'array_padding::arr') ORDER BY name");
+  EXPECT_FALSE(q.lastError().isValid());
+  EXPECT_EQ(selectedRows(q), 2);
+  // The alignment column of arrays is the element size, the reorder
+  // search uses the alignment of the element members instead.
+  EXPECT_TRUE(q.seek(0));
+  EXPECT_EQ(q.value("name").toString(), "array_of_nested::arr");
+  EXPECT_EQ(q.value("byte_size").toULongLong(), 64);
+  EXPECT_EQ(q.value("alignment").toULongLong(), 32);
+  // Arrays of scalars are aligned to the element size
+  EXPECT_TRUE(q.seek(1));
+  EXPECT_EQ(q.value("name").toString(), "array_padding::arr");
+  EXPECT_EQ(q.value("byte_size").toULongLong(), 12);
+  EXPECT_EQ(q.value("alignment").toULongLong(), 4);
+}
+
 TEST_F(TestStorage, TestArrayPadding) {
   std::filesystem::path src("assets/sample_padding");
   auto scraper = setupScraper(src);
@@ -229,3 +255,241 @@ TEST_F(TestStorage, TestPointerUnion) {
   EXPECT_EQ(q.value("nested_padding").toULongLong(), 0);
   EXPECT_EQ(q.value("nested_holes").toULongLong(), 0);
 }
+
+TEST_F(TestStorage, TestPointerFootprint) {
+  std::filesystem::path src("assets/sample_padding");
+  auto scraper = setupScraper(src);
+
+  auto result = execScraper(scraper.get());
+  EXPECT_EQ(result.errors.size(), 0);
+
+  auto q = sm_->query("SELECT f.* FROM layout_footprint f "
+                      "JOIN type_layout t ON f.owner = t.id "
+                      "WHERE t.name = 'pointer_padding'");
+  EXPECT_FALSE(q.lastError().isValid());
+  EXPECT_EQ(selectedRows(q), 1);
+  EXPECT_TRUE(q.seek(0));
+  EXPECT_EQ(q.value("cache_line_size").toULongLong(), 64);
+  EXPECT_EQ(q.value("pointer_count").toULongLong(), 1);
+  EXPECT_EQ(q.value("pointer_bytes").toULongLong(), 16);
+  EXPECT_DOUBLE_EQ(q.value("pointer_density").toDouble(), 16.0 / 48);
+  EXPECT_EQ(q.value("cap_inflation").toULongLong(), 8);
+  EXPECT_EQ(q.value("cache_lines").toULongLong(), 1);
+  EXPECT_EQ(q.value("straddling_members").toULongLong(), 0);
+  EXPECT_EQ(q.value("hot_span_begin").toULongLong(), 16);
+  EXPECT_EQ(q.value("hot_span_end").toULongLong(), 32);
+  EXPECT_EQ(q.value("hot_span_lines").toULongLong(), 1);
+}
+
+TEST_F(TestStorage, TestArrayOfNestedFootprint) {
+  std::filesystem::path src("assets/sample_padding");
+  auto scraper = setupScraper(src);
+
+  auto result = execScraper(scraper.get());
+  EXPECT_EQ(result.errors.size(), 0);
+
+  auto q = sm_->query("SELECT f.* FROM layout_footprint f "
+                      "JOIN type_layout t ON f.owner = t.id "
+                      "WHERE t.name = 'array_of_nested'");
+  EXPECT_FALSE(q.lastError().isValid());
+  EXPECT_EQ(selectedRows(q), 1);
+  EXPECT_TRUE(q.seek(0));
+  EXPECT_EQ(q.value("pointer_count").toULongLong(), 2);
+  EXPECT_EQ(q.value("pointer_bytes").toULongLong(), 32);
+  EXPECT_EQ(q.value("cache_lines").toULongLong(), 2);
+  // The arr member fits in a line but spans [16, 80)
+  EXPECT_EQ(q.value("straddling_members").toULongLong(), 1);
+
+  auto q_straddle = sm_->query("SELECT m.name, s.* FROM cache_line_straddle s "
+                               "JOIN layout_member m ON s.member = m.id "
+                               "WHERE m.name LIKE 'array_of_nested::%'");
+  EXPECT_FALSE(q_straddle.lastError().isValid());
+  EXPECT_EQ(selectedRows(q_straddle), 1);
+  EXPECT_TRUE(q_straddle.seek(0));
+  EXPECT_EQ(q_straddle.value("name").toString(), "array_of_nested::arr");
+  EXPECT_EQ(q_straddle.value("first_line").toULongLong(), 0);
+  EXPECT_EQ(q_straddle.value("last_line").toULongLong(), 1);
+}
+
+TEST_F(TestStorage, TestReorderPaddedStruct) {
+  std::filesystem::path src("assets/sample_padding");
+  auto scraper = setupScraper(src);
+
+  auto result = execScraper(scraper.get());
+  EXPECT_EQ(result.errors.size(), 0);
+
+  auto q = sm_->query("SELECT t.name, r.* FROM layout_reorder r "
+                      "JOIN type_layout t ON r.owner = t.id ORDER BY t.name");
+  EXPECT_FALSE(q.lastError().isValid());
+  // align_inner and no_padding_struct are already compact,
+  // unions are never reordered.
+  EXPECT_EQ(selectedRows(q), 5);
+
+  EXPECT_TRUE(q.seek(0));
+  EXPECT_EQ(q.value("name").toString(), "array_of_nested");
+  EXPECT_EQ(q.value("declared_size").toULongLong(), 96);
+  EXPECT_EQ(q.value("optimized_size").toULongLong(), 80);
+
+  EXPECT_TRUE(q.seek(1));
+  EXPECT_EQ(q.value("name").toString(), "array_padding");
+  EXPECT_EQ(q.value("declared_size").toULongLong(), 20);
+  EXPECT_EQ(q.value("optimized_size").toULongLong(), 16);
+
+  EXPECT_TRUE(q.seek(2));
+  EXPECT_EQ(q.value("name").toString(), "padded_struct");
+  EXPECT_EQ(q.value("declared_size").toULongLong(), 12);
+  EXPECT_EQ(q.value("optimized_size").toULongLong(), 8);
+  EXPECT_EQ(q.value("saving").toULongLong(), 4);
+  EXPECT_TRUE(q.value("optimal").toBool());
+  EXPECT_EQ(q.value("member_order").toString(),
+            "padded_struct::b,padded_struct::a,padded_struct::c");
+
+  EXPECT_TRUE(q.seek(3));
+  EXPECT_EQ(q.value("name").toString(), "parent_padding");
+  EXPECT_EQ(q.value("declared_size").toULongLong(), 64);
+  EXPECT_EQ(q.value("optimized_size").toULongLong(), 48);
+
+  EXPECT_TRUE(q.seek(4));
+  EXPECT_EQ(q.value("name").toString(), "pointer_padding");
+  EXPECT_EQ(q.value("declared_size").toULongLong(), 48);
+  EXPECT_EQ(q.value("optimized_size").toULongLong(), 32);
+  EXPECT_EQ(q.value("member_order").toString(),
+            "pointer_padding::p,pointer_padding::a,pointer_padding::b");
+}
+
+TEST(LayoutReorder, CompactOrder) {
+  // A 16-aligned 4-byte member leaves a hole that only the search can fill
+  std::vector<ReorderItem> items = {{1, 1}, {4, 16}, {8, 8}, {2, 2}};
+  auto best = findCompactOrder(items, /*node_budget=*/1 << 16);
+  EXPECT_TRUE(best.optimal);
+  EXPECT_EQ(best.size, 16);
+  ASSERT_EQ(best.order.size(), 4);
+  EXPECT_EQ(best.order[0], 1);
+
+  auto truncated = findCompactOrder(items, /*node_budget=*/0);
+  EXPECT_FALSE(truncated.optimal);
+  EXPECT_EQ(truncated.size, 32);
+}
+
+TEST_F(TestStorage, TestTopLayoutsBySize) {
+  std::filesystem::path src("assets/sample_padding");
+  auto scraper = std::make_unique<FlatLayoutScraper>(
+      *sm_, std::make_unique<DwarfSource>(src));
+  auto top = std::make_shared<SharedTopLayouts>(2, LayoutMetric::Size);
+  scraper->setTopLayouts(top);
+
+  auto result = execScraper(scraper.get());
+  EXPECT_EQ(result.errors.size(), 0);
+
+  auto entries = top->sorted();
+  ASSERT_EQ(entries.size(), 2);
+  EXPECT_EQ(entries[0].name, "array_of_nested");
+  EXPECT_EQ(entries[0].score, 96);
+  EXPECT_EQ(entries[1].name, "parent_padding");
+  EXPECT_EQ(entries[1].score, 64);
+
+  // Layouts are ranked instead of recorded
+  auto q = sm_->query("SELECT * FROM type_layout");
+  EXPECT_FALSE(q.lastError().isValid());
+  EXPECT_EQ(selectedRows(q), 0);
+}
+
+TEST(TopLayouts, BoundedMerge) {
+  auto make = [](std::string name, unsigned long long score) {
+    RankedLayout entry;
+    entry.name = name;
+    entry.score = score;
+    return entry;
+  };
+  TopLayouts first(2, LayoutMetric::Padding);
+  first.push(make("a", 1));
+  first.push(make("b", 5));
+  first.push(make("b", 5));
+  first.push(make("c", 3));
+  TopLayouts second(2, LayoutMetric::Padding);
+  second.push(make("d", 4));
+  second.push(make("b", 5));
+
+  first.merge(second);
+  auto entries = first.sorted();
+  ASSERT_EQ(entries.size(), 2);
+  EXPECT_EQ(entries[0].name, "b");
+  EXPECT_EQ(entries[1].name, "d");
+}
+
+TEST_F(TestStorage, TestDryRunCounters) {
+  std::filesystem::path src("assets/sample_padding");
+  auto scraper = setupScraper(src);
+  auto result = execScraper(scraper.get());
+  EXPECT_EQ(result.errors.size(), 0);
+
+  auto dry_scraper = setupScraper(src);
+  dry_scraper->setDryRun(true);
+  auto dry_result = execScraper(dry_scraper.get());
+  EXPECT_EQ(dry_result.errors.size(), 0);
+
+  // Single compilation unit, so the counters match the recorded rows
+  auto q = sm_->query("SELECT COUNT(*) AS layouts, "
+                      "SUM(total_padding) AS padding FROM type_layout");
+  EXPECT_FALSE(q.lastError().isValid());
+  EXPECT_TRUE(q.seek(0));
+  EXPECT_EQ(dry_result.layouts, q.value("layouts").toULongLong());
+  EXPECT_EQ(dry_result.total_padding, q.value("padding").toULongLong());
+  EXPECT_EQ(dry_result.layouts, result.layouts);
+  EXPECT_EQ(dry_result.members, result.members);
+
+  auto q_members = sm_->query("SELECT COUNT(*) AS members, "
+                              "SUM(is_imprecise) AS imprecise "
+                              "FROM layout_member");
+  EXPECT_FALSE(q_members.lastError().isValid());
+  EXPECT_TRUE(q_members.seek(0));
+  EXPECT_EQ(dry_result.members, q_members.value("members").toULongLong());
+  EXPECT_EQ(dry_result.imprecise_members,
+            q_members.value("imprecise").toULongLong());
+}
+
+TEST_F(TestStorage, TestProfilePhases) {
+  std::filesystem::path src("assets/sample_padding");
+  auto scraper = setupScraper(src);
+  auto result = execScraper(scraper.get());
+  EXPECT_EQ(result.errors.size(), 0);
+
+  for (auto phase : {"binary_load", "dwarf_context", "elapsed_time",
+                     "unit_scan", "resolve_type", "flatten", "padding",
+                     "db_lock_wait", "db_transaction"}) {
+    EXPECT_TRUE(result.profile.contains(phase)) << "Missing phase " << phase;
+  }
+  EXPECT_EQ(result.profile["elapsed_time"].count, 1);
+  // The sample links the crt units as well
+  EXPECT_EQ(result.profile["unit_scan"].count, 3);
+  EXPECT_GT(result.profile["resolve_type"].count, 0);
+  EXPECT_GT(result.profile["db_transaction"].count, 0);
+  EXPECT_GE(result.profile["elapsed_time"].total,
+            result.profile["unit_scan"].total);
+
+  ScraperResult total;
+  total.merge(result);
+  total.merge(result);
+  EXPECT_EQ(total.profile["unit_scan"].count, 6);
+}
+
+TEST_F(TestStorage, TestMemoryAccounting) {
+  std::filesystem::path src("assets/sample_padding");
+  auto scraper = setupScraper(src);
+  auto result = execScraper(scraper.get());
+  EXPECT_EQ(result.errors.size(), 0);
+
+  EXPECT_GT(result.memory.mapped_bytes, 0);
+  EXPECT_GT(result.memory.die_bytes, 0);
+  EXPECT_GT(result.memory.state_peak_bytes, 0);
+  EXPECT_EQ(result.memory.total(),
+            result.memory.mapped_bytes + result.memory.die_bytes +
+                result.memory.state_peak_bytes);
+  EXPECT_GT(peakResidentBytes(), 0);
+
+  ScraperResult total;
+  total.merge(result);
+  total.merge(result);
+  EXPECT_EQ(total.memory.mapped_bytes, 2 * result.memory.mapped_bytes);
+  EXPECT_EQ(total.memory.state_peak_bytes, result.memory.state_peak_bytes);
+}
@@ -0,0 +1,77 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Alfredo Mazzinghi
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+#include <filesystem>
+
+#include "fixture.hh"
+#include "progress.hh"
+
+using namespace cheri;
+
+TEST(Progress, FormatAndEstimate) {
+  ProgressSample prev;
+  ProgressSample cur;
+  cur.elapsed = std::chrono::seconds(10);
+  cur.jobs_total = 4;
+  cur.jobs_started = 2;
+  cur.jobs_done = 1;
+  cur.units_total = 10;
+  cur.units = 5;
+  cur.dies = 1000;
+  cur.layouts = 20;
+  cur.queue_depth = 1;
+
+  // The 2 jobs that did not start are assumed to have 5 units each,
+  // so we are at 5/20 units.
+  auto remaining = cur.remaining();
+  ASSERT_TRUE(remaining);
+  EXPECT_DOUBLE_EQ(remaining->count(), 30);
+  EXPECT_EQ(formatProgress(prev, cur),
+            "progress: jobs 1/4 units 5/10 (0.5/s) dies 1000 (100.0/s) "
+            "layouts 20 (2.0/s) db queue 1 elapsed 10s eta 30s");
+
+  cur.jobs_done = 4;
+  EXPECT_DOUBLE_EQ(cur.remaining()->count(), 0);
+  EXPECT_FALSE(ProgressSample().remaining());
+}
+
+TEST_F(TestStorage, ProgressCounters) {
+  std::filesystem::path src("assets/sample_padding");
+  auto scraper = setupScraper(src);
+  auto progress = std::make_shared<ProgressCounters>();
+  scraper->setProgress(progress);
+
+  auto result = execScraper(scraper.get());
+  EXPECT_EQ(result.errors.size(), 0);
+  EXPECT_EQ(progress->jobs_started.load(), 1);
+  EXPECT_EQ(progress->units_total.load(), 3);
+  EXPECT_EQ(progress->units.load(), 3);
+  EXPECT_GT(progress->dies.load(), 0);
+  EXPECT_EQ(progress->layouts.load(), result.layouts);
+  EXPECT_EQ(sm_->queueDepth(), 0);
+}
@@ -0,0 +1,100 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Alfredo Mazzinghi
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+#include <filesystem>
+#include <sstream>
+
+#include <QJsonArray>
+#include <QJsonDocument>
+
+#include "fixture.hh"
+#include "run_report.hh"
+
+using namespace cheri;
+
+TEST_F(TestStorage, DuplicateCounters) {
+  std::filesystem::path src("assets/sample_padding");
+  auto scraper = setupScraper(src);
+  auto result = execScraper(scraper.get());
+  EXPECT_EQ(result.errors.size(), 0);
+  EXPECT_EQ(result.units, 3);
+  EXPECT_GT(result.dies, 0);
+  EXPECT_GT(result.layouts, 0);
+
+  // Scanning again finds every layout already recorded
+  auto rescan = setupScraper(src);
+  auto dup_result = execScraper(rescan.get());
+  EXPECT_EQ(dup_result.errors.size(), 0);
+  EXPECT_EQ(dup_result.layouts, result.layouts);
+  EXPECT_EQ(dup_result.dup_structs, result.dup_structs + result.layouts);
+  EXPECT_EQ(dup_result.dup_members, result.members);
+}
+
+TEST_F(TestStorage, JSONRunReport) {
+  std::filesystem::path src("assets/sample_padding");
+  auto scraper = setupScraper(src);
+  auto result = execScraper(scraper.get());
+  EXPECT_EQ(result.errors.size(), 0);
+
+  std::ostringstream out;
+  writeRunReport(out, {result, result},
+                 {{"assets/sample_missing", "Can not open binary"}});
+  QJsonParseError error;
+  auto doc = QJsonDocument::fromJson(QByteArray::fromStdString(out.str()),
+                                     &error);
+  ASSERT_EQ(error.error, QJsonParseError::NoError);
+  auto report = doc.object();
+
+  // Both jobs scanned the same binary, the failed job gets its own entry
+  auto binaries = report["binaries"].toArray();
+  ASSERT_EQ(binaries.size(), 2);
+  auto missing = binaries[0].toObject();
+  EXPECT_EQ(missing["binary"].toString(), "assets/sample_missing");
+  EXPECT_TRUE(missing["failed"].toBool());
+  EXPECT_EQ(missing["failed_jobs"].toInteger(), 1);
+  EXPECT_EQ(missing["error"].toString(), "Can not open binary");
+  EXPECT_EQ(missing["jobs"].toInteger(), 0);
+
+  auto binary = binaries[1].toObject();
+  EXPECT_EQ(binary["binary"].toString(), "assets/sample_padding");
+  EXPECT_FALSE(binary["failed"].toBool());
+  EXPECT_FALSE(binary.contains("error"));
+  EXPECT_EQ(binary["jobs"].toInteger(), 2);
+  EXPECT_EQ(binary["units"].toInteger(), 2 * result.units);
+  EXPECT_EQ(binary["layouts"].toInteger(), 2 * result.layouts);
+  EXPECT_EQ(binary["errors"].toArray().size(), 0);
+  EXPECT_TRUE(binary["timings"].toObject().contains("unit_scan"));
+  EXPECT_EQ(binary["timings"]["unit_scan"]["count"].toInteger(), 6);
+
+  auto totals = report["totals"].toObject();
+  EXPECT_EQ(totals["binaries"].toInteger(), 2);
+  EXPECT_EQ(totals["jobs"].toInteger(), 2);
+  EXPECT_EQ(totals["failed_jobs"].toInteger(), 1);
+  EXPECT_EQ(totals["dies"].toInteger(), 2 * result.dies);
+  EXPECT_GT(report["peak_rss_bytes"].toInteger(), 0);
+}
@@ -0,0 +1,104 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Alfredo Mazzinghi
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+#include <filesystem>
+
+#include "fixture.hh"
+#include "stack_frame_scraper.hh"
+
+using namespace cheri;
+
+TEST(StackFrame, LocalGrowth) {
+  StackLocalInfo local;
+  local.fb_offset = -0x1010;
+  local.size = 0x1001;
+  local.padded_size = 0x1008;
+  local.required_align = 8;
+  // Length padding only
+  EXPECT_TRUE(local.isImprecise(16));
+  EXPECT_EQ(localFrameGrowth(local, 16), 7);
+
+  local.fb_offset = -0x1008;
+  EXPECT_EQ(localFrameGrowth(local, 16), 7);
+
+  // Length padding and the local is not aligned
+  local.fb_offset = -0x1004;
+  EXPECT_EQ(localFrameGrowth(local, 16), 14);
+
+  // The frame must be realigned
+  local.size = local.padded_size = 0x10000;
+  local.required_align = 0x20;
+  local.fb_offset = -0x10020;
+  EXPECT_TRUE(local.isImprecise(16));
+  EXPECT_EQ(localFrameGrowth(local, 16), 0x10);
+  EXPECT_FALSE(local.isImprecise(0x20));
+
+  local.size = local.padded_size = 0x10;
+  local.required_align = 1;
+  EXPECT_FALSE(local.isImprecise(16));
+  EXPECT_EQ(localFrameGrowth(local, 16), 0);
+}
+
+TEST_F(TestStorage, StackFrameLocals) {
+  std::filesystem::path src("assets/sample_padding");
+
+  // Split the units in two shards, the results must cover all frames
+  for (unsigned long shard = 0; shard < 2; shard++) {
+    auto scraper = std::make_unique<StackFrameScraper>(
+        *sm_, std::make_unique<DwarfSource>(src));
+    scraper->setShard(shard, 2);
+    auto result = execScraper(scraper.get());
+    EXPECT_EQ(result.errors.size(), 0);
+    // The mapped binary is only counted by the first shard
+    if (shard == 0)
+      EXPECT_GT(result.memory.mapped_bytes, 0);
+    else
+      EXPECT_EQ(result.memory.mapped_bytes, 0);
+  }
+
+  auto q = sm_->query("SELECT * FROM stack_frame WHERE name = 'main'");
+  EXPECT_FALSE(q.lastError().isValid());
+  ASSERT_EQ(selectedRows(q), 1);
+  EXPECT_TRUE(q.seek(0));
+  EXPECT_EQ(q.value("locals").toULongLong(), 9);
+  EXPECT_EQ(q.value("imprecise_locals").toULongLong(), 0);
+  EXPECT_EQ(q.value("frame_padding").toULongLong(), 0);
+  EXPECT_NE(q.value("low_pc").toULongLong(), 0);
+  auto frame_id = q.value("id");
+
+  auto q_local = sm_->prepare(
+      "SELECT * FROM stack_local WHERE frame = :frame AND name = 'pp'");
+  q_local.bindValue(":frame", frame_id);
+  ASSERT_TRUE(q_local.exec());
+  ASSERT_EQ(selectedRows(q_local), 1);
+  EXPECT_TRUE(q_local.seek(0));
+  EXPECT_EQ(q_local.value("type_name").toString(), "pointer_padding");
+  EXPECT_EQ(q_local.value("fb_offset").toLongLong(), -128);
+  EXPECT_EQ(q_local.value("size").toULongLong(), 32);
+  EXPECT_FALSE(q_local.value("is_param").toBool());
+}
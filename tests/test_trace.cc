@@ -0,0 +1,87 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Alfredo Mazzinghi
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+#include <filesystem>
+#include <set>
+#include <sstream>
+
+#include <QJsonArray>
+#include <QJsonDocument>
+
+#include "fixture.hh"
+#include "pool.hh"
+#include "trace.hh"
+
+using namespace cheri;
+
+TEST(Trace, DisabledByDefault) {
+  Tracer::reset();
+  { TraceScope span("unit"); }
+  std::ostringstream out;
+  Tracer::write(out);
+  EXPECT_EQ(out.str().find("\"unit\""), std::string::npos);
+}
+
+TEST_F(TestStorage, ChromeTraceSpans) {
+  Tracer::enable();
+  Tracer::nameThread("main");
+  {
+    ThreadPool pool(1);
+    std::filesystem::path src("assets/sample_padding");
+    auto result = pool.schedule(setupScraper(src)).get();
+    EXPECT_EQ(result.errors.size(), 0);
+    pool.wait();
+  }
+
+  std::ostringstream out;
+  Tracer::write(out);
+  Tracer::reset();
+  QJsonParseError error;
+  auto doc = QJsonDocument::fromJson(QByteArray::fromStdString(out.str()),
+                                     &error);
+  ASSERT_EQ(error.error, QJsonParseError::NoError);
+
+  std::set<QString> spans;
+  std::set<QString> threads;
+  for (auto value : doc.object()["traceEvents"].toArray()) {
+    auto event = value.toObject();
+    if (event["ph"].toString() == "M") {
+      threads.insert(event["args"]["name"].toString());
+    } else {
+      EXPECT_EQ(event["ph"].toString(), "X");
+      EXPECT_GE(event["dur"].toDouble(), 0);
+      spans.insert(event["name"].toString());
+    }
+  }
+  for (auto name : {"load_source", "job", "unit", "flatten", "lock_wait",
+                    "commit"}) {
+    EXPECT_TRUE(spans.contains(name)) << "Missing span " << name;
+  }
+  EXPECT_TRUE(threads.contains("main"));
+  EXPECT_TRUE(threads.contains("worker"));
+}